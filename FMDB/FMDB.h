@@ -17,4 +17,5 @@ FOUNDATION_EXPORT const unsigned char FMDBVersionString[];
 #import "FMDatabasePool.h"
 
 #define SQLITE_OPEN_READWRITE 0x00000002
+#define SQLITE_OPEN_FULLMUTEX 0x00010000
 #define FMDB_SQL_NULLABLE(OBJ) ((OBJ) ?: [NSNull null])
@@ -26,10 +26,23 @@
  kLastAcquisitionOrigin
  kLastExpenditureDate
  kLastExpenditureDestination
+ kBackupDirectory (scheduled backups are written here)
+ kBackupInterval (hours between scheduled backups, 0 disables them)
+ kMaintenanceBudget (milliseconds a database maintenance slice may run)
+ kStorageProfile (DatabaseStorageProfile the database is opened with)
+ kStartupSnapshot (main window state saved at quit so the next launch draws without querying)
+ kColumnarSearch (parametric searches filter an in-memory columnar copy of stock)
  */
 + (void)initialize {
     // Register configuration
-    NSDictionary *defaultValues = @{ @"kDBFileLocation" : @"" };
+    NSDictionary *defaultValues = @{
+        @"kDBFileLocation" : @"",
+        @"kBackupDirectory" : @"",
+        @"kBackupInterval" : @0,
+        @"kMaintenanceBudget" : @20,
+        @"kStorageProfile" : [NSNumber numberWithInteger:DatabaseStorageProfileDurable],
+        @"kColumnarSearch" : @NO
+    };
     [[NSUserDefaults standardUserDefaults] registerDefaults:defaultValues];
 }
 
@@ -57,6 +70,7 @@
 
 
 - (void)applicationWillTerminate:(NSNotification *)aNotification {
+    [_mainWindowController saveStartupSnapshot];
     [[DatabaseController sharedController] closeDatabase];
 }
 
@@ -71,9 +85,38 @@
 }
 
 
+- (IBAction)backUpMenuItemClicked:(id)sender {
+    NSString *dbFilePath = [[NSUserDefaults standardUserDefaults] stringForKey:@"kDBFileLocation"];
+    NSSavePanel *savePanel = [NSSavePanel savePanel];
+    [savePanel setNameFieldStringValue:[NSString stringWithFormat:@"%@ Backup.sqlite", [[dbFilePath lastPathComponent] stringByDeletingPathExtension]]];
+    if ([savePanel runModal] != NSModalResponseOK) {
+        return;
+    }
+    NSString *backupPath = [NSString stringWithUTF8String:[[savePanel URL] fileSystemRepresentation]];
+    NSDockTile *dockTile = [NSApp dockTile];
+    DatabaseBackup *backup = [[DatabaseController sharedController] backUpDatabaseToPath:backupPath progressHandler:^(double progress) {
+        [dockTile setBadgeLabel:[NSString stringWithFormat:@"%.0f%%", progress * 100.0]];
+    } completionHandler:^(BOOL success) {
+        [dockTile setBadgeLabel:nil];
+        if (!success) {
+            [self backupFailedUserAlertForPath:backupPath];
+        }
+    }];
+    if (!backup) {
+        [self backupFailedUserAlertForPath:backupPath];
+    }
+}
+
+
 - (void)setUpMainWindow {
     NSString *dbFilePath = [[NSUserDefaults standardUserDefaults] stringForKey:@"kDBFileLocation"];
+    [[DatabaseController sharedController] setStorageProfile:[[NSUserDefaults standardUserDefaults] integerForKey:@"kStorageProfile"]];
+    [[DatabaseController sharedController] setUsesColumnarMirror:[[NSUserDefaults standardUserDefaults] boolForKey:@"kColumnarSearch"]];
     if ([[DatabaseController sharedController] openDatabaseAtPath:dbFilePath]) {
+        NSString *backupDirectory = [[NSUserDefaults standardUserDefaults] stringForKey:@"kBackupDirectory"];
+        NSTimeInterval backupInterval = [[NSUserDefaults standardUserDefaults] doubleForKey:@"kBackupInterval"] * 3600.0;
+        [[DatabaseController sharedController] scheduleBackupsToDirectory:backupDirectory interval:backupInterval];
+        [[DatabaseController sharedController] setMaintenanceTimeBudget:[[NSUserDefaults standardUserDefaults] doubleForKey:@"kMaintenanceBudget"] / 1000.0];
         [self showMainWindow];
     } else {
         [self missingDatabaseUserAlert];
@@ -113,6 +156,15 @@
     }
 }
 
+
+- (void)backupFailedUserAlertForPath:(NSString *)path {
+    NSAlert *alert = [[NSAlert alloc] init];
+    [alert setAlertStyle:NSAlertStyleWarning];
+    [alert setMessageText:@"Could not back up the database."];
+    [alert setInformativeText:[NSString stringWithFormat:@"The backup to '%@' did not complete. Another backup may still be running.", path]];
+    [alert runModal];
+}
+
 #pragma mark - Notification Handlers
 
 - (void)databasePathDidChangeNotification:(NSNotification *)notification {
@@ -0,0 +1,38 @@
+//
+//  ColumnarStockMirror.h
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+@class FMDatabase;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ In-memory copy of the stock table laid out column by column for parametric filtering.
+ Ratings and quantities are double arrays with NaN standing in for NULL, so a range test
+ rejects missing values without a separate check, and type, manufacturer and package code
+ are held as their lookup table ids. A filter keeps one bit per row and narrows it with a
+ vectorized scan of each constrained column. The copy follows the stock change notifications
+ posted by its sender instead of being reloaded.
+ */
+@interface ColumnarStockMirror : NSObject
+
+@property (readonly) NSUInteger count;
+
+/*
+ Rows are read once from rowSource, which may be another connection to the same file so the
+ load can run off the main thread; later lookups go through database. Nothing is followed
+ until followChangesPostedBy: is called, on the queue the notifications are posted on.
+ */
+- (instancetype)initWithDatabase:(FMDatabase *)database rowsFromDatabase:(FMDatabase *)rowSource;
+- (void)followChangesPostedBy:(id)sender;
+- (NSArray<NSNumber *> *)componentIDsMatchingParameters:(NSDictionary *)parameters;
+- (NSUInteger)countOfComponentsMatchingParameters:(NSDictionary *)parameters;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,446 @@
+//
+//  ColumnarStockMirror.m
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import "ColumnarStockMirror.h"
+#import "ComponentRating.h"
+#import "FMDB.h"
+#if defined(__SSE2__)
+#import <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#import <arm_neon.h>
+#endif
+
+#define RATING_COLUMN_COUNT (ComponentRatingKindTolerance + 1)
+#define ROWS_PER_WORD 64 //Columns are padded to whole selection words, so scans have no tail
+#define COLUMN_ALIGNMENT 64
+#define INITIAL_CAPACITY 1024
+#define NULL_ID 0 //Stands for a NULL manufacturer or package code; lookup table ids start at 1
+#define FIRST_RATING_COLUMN_INDEX 5 //Position of the first rating in the loading query
+
+/*
+ Bit i is set when values[i] lies within [lower, upper]. Ordered comparisons are false
+ for NaN, so NULL values never match.
+ */
+static uint64_t rangeMask(const double *values, double lower, double upper) {
+    uint64_t mask = 0;
+#if defined(__AVX__)
+    __m256d low = _mm256_set1_pd(lower);
+    __m256d high = _mm256_set1_pd(upper);
+    for (int i = 0; i < ROWS_PER_WORD; i += 4) {
+        __m256d x = _mm256_load_pd(values + i);
+        __m256d inside = _mm256_and_pd(_mm256_cmp_pd(x, low, _CMP_GE_OQ), _mm256_cmp_pd(x, high, _CMP_LE_OQ));
+        mask |= (uint64_t)_mm256_movemask_pd(inside) << i;
+    }
+#elif defined(__SSE2__)
+    __m128d low = _mm_set1_pd(lower);
+    __m128d high = _mm_set1_pd(upper);
+    for (int i = 0; i < ROWS_PER_WORD; i += 2) {
+        __m128d x = _mm_load_pd(values + i);
+        __m128d inside = _mm_and_pd(_mm_cmpge_pd(x, low), _mm_cmple_pd(x, high));
+        mask |= (uint64_t)_mm_movemask_pd(inside) << i;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    float64x2_t low = vdupq_n_f64(lower);
+    float64x2_t high = vdupq_n_f64(upper);
+    const uint64x2_t lanes = { 1, 2 };
+    for (int i = 0; i < ROWS_PER_WORD; i += 2) {
+        float64x2_t x = vld1q_f64(values + i);
+        uint64x2_t inside = vandq_u64(vcgeq_f64(x, low), vcleq_f64(x, high));
+        mask |= vaddvq_u64(vandq_u64(inside, lanes)) << i;
+    }
+#else
+    for (int i = 0; i < ROWS_PER_WORD; i++) {
+        mask |= (uint64_t)(values[i] >= lower && values[i] <= upper) << i;
+    }
+#endif
+    return mask;
+}
+
+
+// Bit i is set when ids[i] equals the given id
+static uint64_t equalityMask(const uint32_t *ids, uint32_t identifier) {
+    uint64_t mask = 0;
+#if defined(__AVX2__)
+    __m256i target = _mm256_set1_epi32((int)identifier);
+    for (int i = 0; i < ROWS_PER_WORD; i += 8) {
+        __m256i equal = _mm256_cmpeq_epi32(_mm256_load_si256((const __m256i *)(ids + i)), target);
+        mask |= (uint64_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(equal)) << i;
+    }
+#elif defined(__SSE2__)
+    __m128i target = _mm_set1_epi32((int)identifier);
+    for (int i = 0; i < ROWS_PER_WORD; i += 4) {
+        __m128i equal = _mm_cmpeq_epi32(_mm_load_si128((const __m128i *)(ids + i)), target);
+        mask |= (uint64_t)(uint32_t)_mm_movemask_ps(_mm_castsi128_ps(equal)) << i;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    uint32x4_t target = vdupq_n_u32(identifier);
+    const uint32x4_t lanes = { 1, 2, 4, 8 };
+    for (int i = 0; i < ROWS_PER_WORD; i += 4) {
+        uint32x4_t equal = vceqq_u32(vld1q_u32(ids + i), target);
+        mask |= (uint64_t)vaddvq_u32(vandq_u32(equal, lanes)) << i;
+    }
+#else
+    for (int i = 0; i < ROWS_PER_WORD; i++) {
+        mask |= (uint64_t)(ids[i] == identifier) << i;
+    }
+#endif
+    return mask;
+}
+
+
+// Words already cleared by an earlier predicate are skipped, so later columns scan fewer rows
+static void intersectRange(uint64_t *selection, size_t wordCount, const double *column, double lower, double upper) {
+    for (size_t word = 0; word < wordCount; word++) {
+        if (selection[word]) {
+            selection[word] &= rangeMask(column + word * ROWS_PER_WORD, lower, upper);
+        }
+    }
+}
+
+
+static void intersectEquality(uint64_t *selection, size_t wordCount, const uint32_t *column, uint32_t identifier) {
+    for (size_t word = 0; word < wordCount; word++) {
+        if (selection[word]) {
+            selection[word] &= equalityMask(column + word * ROWS_PER_WORD, identifier);
+        }
+    }
+}
+
+
+// Aligned copy of a column grown to capacity; the new rows are left for the caller to fill
+static void *resizedColumn(void *column, NSUInteger count, NSUInteger capacity, size_t elementSize) {
+    void *resized = NULL;
+    if (posix_memalign(&resized, COLUMN_ALIGNMENT, capacity * elementSize) != 0) {
+        return NULL;
+    }
+    if (column) {
+        memcpy(resized, column, count * elementSize);
+        free(column);
+    }
+    return resized;
+}
+
+
+static void fillWithNaN(double *column, NSUInteger start, NSUInteger end) {
+    for (NSUInteger row = start; row < end; row++) {
+        column[row] = NAN;
+    }
+}
+
+@interface ColumnarStockMirror ()
+
+@property FMDatabase *database;
+@property (readwrite) NSUInteger count;
+@property NSString *columnList;
+
+@end
+
+@implementation ColumnarStockMirror {
+    NSUInteger _capacity;
+    int64_t *_componentIDColumn;
+    double *_quantityColumn; //Held as double so quantity bounds reuse the rating scan; exact below 2^53
+    double *_ratingColumns[RATING_COLUMN_COUNT];
+    uint32_t *_typeColumn;
+    uint32_t *_manufacturerColumn;
+    uint32_t *_packageColumn;
+    CFMutableDictionaryRef _rows; //Component id to row, both stored as plain integers
+}
+
+- (instancetype)initWithDatabase:(FMDatabase *)database rowsFromDatabase:(FMDatabase *)rowSource {
+    self = [super init];
+    if (self) {
+        _database = database;
+        _rows = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, NULL, NULL);
+        NSMutableArray<NSString *> *columns = [[NSMutableArray alloc] initWithObjects:@"component_id", @"quantity", @"component_type_id", @"manufacturer_id", @"package_code_id", nil];
+        for (NSInteger kind = 0; kind < RATING_COLUMN_COUNT; kind++) {
+            [columns addObject:[ComponentRating columnNameForKind:kind]];
+        }
+        _columnList = [columns componentsJoinedByString:@", "];
+        [self loadAllRowsFromDatabase:rowSource];
+    }
+    return self;
+}
+
+
+- (void)followChangesPostedBy:(id)sender {
+    NSNotificationCenter *notificationCenter = [NSNotificationCenter defaultCenter];
+    [notificationCenter addObserver:self
+                           selector:@selector(stockUpdatedNotification:)
+                               name:@"DBCStockUpdatedNotification"
+                             object:sender];
+    [notificationCenter addObserver:self
+                           selector:@selector(kitWithdrawnNotification:)
+                               name:@"DBCKitWithdrawnNotification"
+                             object:sender];
+    [notificationCenter addObserver:self
+                           selector:@selector(componentRegisteredNotification:)
+                               name:@"DBCComponentRegisteredNotification"
+                             object:sender];
+    [notificationCenter addObserver:self
+                           selector:@selector(componentRemovedNotification:)
+                               name:@"DBCComponentRemovedNotification"
+                             object:sender];
+}
+
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    free(_componentIDColumn);
+    free(_quantityColumn);
+    for (NSInteger kind = 0; kind < RATING_COLUMN_COUNT; kind++) {
+        free(_ratingColumns[kind]);
+    }
+    free(_typeColumn);
+    free(_manufacturerColumn);
+    free(_packageColumn);
+    CFRelease(_rows);
+}
+
+
+- (void)loadAllRowsFromDatabase:(FMDatabase *)rowSource {
+    NSUInteger rowCount = (NSUInteger)MAX([rowSource intForQuery:@"SELECT COUNT(*) FROM stock"], 0);
+    [self reserveCapacity:rowCount];
+    NSString *query = [NSString stringWithFormat:@"SELECT %@ FROM stock", _columnList];
+    FMResultSet *resultSet = [rowSource executeQuery:query];
+    while ([resultSet next]) {
+        [self storeResultSet:resultSet inRow:[self appendRow]];
+    }
+    [resultSet close];
+}
+
+
+- (void)reserveCapacity:(NSUInteger)capacity {
+    if (capacity <= _capacity) {
+        return;
+    }
+    // Powers of two from INITIAL_CAPACITY up are whole selection words
+    NSUInteger newCapacity = MAX(_capacity, INITIAL_CAPACITY);
+    while (newCapacity < capacity) {
+        newCapacity *= 2;
+    }
+    _componentIDColumn = resizedColumn(_componentIDColumn, _count, newCapacity, sizeof(int64_t));
+    _quantityColumn = resizedColumn(_quantityColumn, _count, newCapacity, sizeof(double));
+    fillWithNaN(_quantityColumn, _count, newCapacity);
+    for (NSInteger kind = 0; kind < RATING_COLUMN_COUNT; kind++) {
+        _ratingColumns[kind] = resizedColumn(_ratingColumns[kind], _count, newCapacity, sizeof(double));
+        fillWithNaN(_ratingColumns[kind], _count, newCapacity);
+    }
+    _typeColumn = resizedColumn(_typeColumn, _count, newCapacity, sizeof(uint32_t));
+    _manufacturerColumn = resizedColumn(_manufacturerColumn, _count, newCapacity, sizeof(uint32_t));
+    _packageColumn = resizedColumn(_packageColumn, _count, newCapacity, sizeof(uint32_t));
+    memset(_typeColumn + _count, 0, (newCapacity - _count) * sizeof(uint32_t));
+    memset(_manufacturerColumn + _count, 0, (newCapacity - _count) * sizeof(uint32_t));
+    memset(_packageColumn + _count, 0, (newCapacity - _count) * sizeof(uint32_t));
+    _capacity = newCapacity;
+}
+
+
+- (NSUInteger)appendRow {
+    [self reserveCapacity:_count + 1];
+    return _count++;
+}
+
+
+- (void)storeResultSet:(FMResultSet *)resultSet inRow:(NSUInteger)row {
+    int64_t componentID = [resultSet longLongIntForColumnIndex:0];
+    _componentIDColumn[row] = componentID;
+    _quantityColumn[row] = (double)[resultSet longLongIntForColumnIndex:1];
+    // Lookup table ids are never reassigned, so the columns hold them as they are
+    _typeColumn[row] = (uint32_t)[resultSet longLongIntForColumnIndex:2];
+    _manufacturerColumn[row] = [resultSet columnIndexIsNull:3] ? NULL_ID : (uint32_t)[resultSet longLongIntForColumnIndex:3];
+    _packageColumn[row] = [resultSet columnIndexIsNull:4] ? NULL_ID : (uint32_t)[resultSet longLongIntForColumnIndex:4];
+    for (NSInteger kind = 0; kind < RATING_COLUMN_COUNT; kind++) {
+        int columnIndex = FIRST_RATING_COLUMN_INDEX + (int)kind;
+        _ratingColumns[kind][row] = [resultSet columnIndexIsNull:columnIndex] ? NAN : [resultSet doubleForColumnIndex:columnIndex];
+    }
+    CFDictionarySetValue(_rows, (const void *)(intptr_t)componentID, (const void *)(uintptr_t)row);
+}
+
+
+- (BOOL)getRow:(NSUInteger *)row forComponentID:(NSNumber *)componentID {
+    const void *value = NULL;
+    if (!CFDictionaryGetValueIfPresent(_rows, (const void *)(intptr_t)[componentID longLongValue], &value)) {
+        return NO;
+    }
+    *row = (NSUInteger)(uintptr_t)value;
+    return YES;
+}
+
+
+- (void)reloadComponentID:(NSNumber *)componentID {
+    NSString *query = [NSString stringWithFormat:@"SELECT %@ FROM stock WHERE component_id = ?", _columnList];
+    FMResultSet *resultSet = [_database executeQuery:query, componentID];
+    if ([resultSet next]) {
+        NSUInteger row = 0;
+        if (![self getRow:&row forComponentID:componentID]) {
+            row = [self appendRow];
+        }
+        [self storeResultSet:resultSet inRow:row];
+    } else {
+        [self removeComponentID:componentID];
+    }
+    [resultSet close];
+}
+
+
+- (void)removeComponentID:(NSNumber *)componentID {
+    NSUInteger row = 0;
+    if (![self getRow:&row forComponentID:componentID]) {
+        return;
+    }
+    // The last row fills the hole, so the columns stay dense
+    NSUInteger last = _count - 1;
+    if (row != last) {
+        _componentIDColumn[row] = _componentIDColumn[last];
+        _quantityColumn[row] = _quantityColumn[last];
+        for (NSInteger kind = 0; kind < RATING_COLUMN_COUNT; kind++) {
+            _ratingColumns[kind][row] = _ratingColumns[kind][last];
+        }
+        _typeColumn[row] = _typeColumn[last];
+        _manufacturerColumn[row] = _manufacturerColumn[last];
+        _packageColumn[row] = _packageColumn[last];
+        CFDictionarySetValue(_rows, (const void *)(intptr_t)_componentIDColumn[row], (const void *)(uintptr_t)row);
+    }
+    _quantityColumn[last] = NAN;
+    for (NSInteger kind = 0; kind < RATING_COLUMN_COUNT; kind++) {
+        _ratingColumns[kind][last] = NAN;
+    }
+    _typeColumn[last] = NULL_ID;
+    _manufacturerColumn[last] = NULL_ID;
+    _packageColumn[last] = NULL_ID;
+    CFDictionaryRemoveValue(_rows, (const void *)(intptr_t)[componentID longLongValue]);
+    _count--;
+}
+
+
+- (void)setQuantity:(NSNumber *)quantity forComponentID:(NSNumber *)componentID {
+    NSUInteger row = 0;
+    if ([self getRow:&row forComponentID:componentID]) {
+        _quantityColumn[row] = [quantity doubleValue];
+    } else {
+        [self reloadComponentID:componentID];
+    }
+}
+
+
+/*
+ Parameters are those of -[DatabaseController searchResultsForParameters:], plus a "manufacturer"
+ equality and "quantity_min" / "quantity_max" bounds. Returns nil when a named value doesn't occur
+ in stock, as then nothing can match.
+ */
+- (nullable NSMutableData *)selectionForParameters:(NSDictionary *)parameters {
+    size_t wordCount = (_count + ROWS_PER_WORD - 1) / ROWS_PER_WORD;
+    NSMutableData *selection = [[NSMutableData alloc] initWithLength:MAX(wordCount, 1) * sizeof(uint64_t)];
+    uint64_t *words = [selection mutableBytes];
+    if (wordCount == 0) {
+        return selection;
+    }
+    memset(words, 0xFF, wordCount * sizeof(uint64_t));
+    if (_count % ROWS_PER_WORD) {
+        words[wordCount - 1] = (UINT64_C(1) << (_count % ROWS_PER_WORD)) - 1;
+    }
+    NSDictionary<NSString *, NSString *> *lookupTables = @{
+        @"component_type" : @"component_types",
+        @"manufacturer" : @"manufacturers",
+        @"package_code" : @"package_codes"
+    };
+    for (NSString *key in lookupTables) {
+        NSString *name = [parameters objectForKey:key];
+        if (!name) {
+            continue;
+        }
+        NSString *query = [NSString stringWithFormat:@"SELECT id FROM %@ WHERE name = ? AND ref_count > 0", [lookupTables objectForKey:key]];
+        FMResultSet *resultSet = [_database executeQuery:query, name];
+        NSNumber *identifier = [resultSet next] ? [NSNumber numberWithLongLong:[resultSet longLongIntForColumnIndex:0]] : nil;
+        [resultSet close];
+        if (!identifier) {
+            return nil;
+        }
+        const uint32_t *column = [key isEqualToString:@"component_type"] ? _typeColumn
+                               : [key isEqualToString:@"manufacturer"] ? _manufacturerColumn : _packageColumn;
+        intersectEquality(words, wordCount, column, [identifier unsignedIntValue]);
+    }
+    for (NSInteger kind = -1; kind < RATING_COLUMN_COUNT; kind++) {
+        NSString *column = kind < 0 ? @"quantity" : [ComponentRating columnNameForKind:kind];
+        id minimum = [parameters objectForKey:[column stringByAppendingString:@"_min"]];
+        id maximum = [parameters objectForKey:[column stringByAppendingString:@"_max"]];
+        if (!minimum && !maximum) {
+            continue;
+        }
+        double lower = -INFINITY;
+        double upper = INFINITY;
+        if (minimum) {
+            lower = [minimum isKindOfClass:[ComponentRating class]] ? [minimum value] : [minimum doubleValue];
+        }
+        if (maximum) {
+            upper = [maximum isKindOfClass:[ComponentRating class]] ? [maximum value] : [maximum doubleValue];
+        }
+        intersectRange(words, wordCount, kind < 0 ? _quantityColumn : _ratingColumns[kind], lower, upper);
+    }
+    return selection;
+}
+
+
+- (NSArray<NSNumber *> *)componentIDsMatchingParameters:(NSDictionary *)parameters {
+    NSData *selection = [self selectionForParameters:parameters];
+    if (!selection) {
+        return @[];
+    }
+    const uint64_t *words = [selection bytes];
+    size_t wordCount = (_count + ROWS_PER_WORD - 1) / ROWS_PER_WORD;
+    NSMutableArray<NSNumber *> *componentIDs = [[NSMutableArray alloc] init];
+    for (size_t word = 0; word < wordCount; word++) {
+        for (uint64_t bits = words[word]; bits; bits &= bits - 1) {
+            size_t row = word * ROWS_PER_WORD + (size_t)__builtin_ctzll(bits);
+            [componentIDs addObject:[NSNumber numberWithLongLong:_componentIDColumn[row]]];
+        }
+    }
+    return componentIDs;
+}
+
+
+- (NSUInteger)countOfComponentsMatchingParameters:(NSDictionary *)parameters {
+    NSData *selection = [self selectionForParameters:parameters];
+    if (!selection) {
+        return 0;
+    }
+    const uint64_t *words = [selection bytes];
+    size_t wordCount = (_count + ROWS_PER_WORD - 1) / ROWS_PER_WORD;
+    NSUInteger count = 0;
+    for (size_t word = 0; word < wordCount; word++) {
+        count += (NSUInteger)__builtin_popcountll(words[word]);
+    }
+    return count;
+}
+
+#pragma mark - Notification Handlers
+
+- (void)stockUpdatedNotification:(NSNotification *)notification {
+    [self setQuantity:[[notification userInfo] objectForKey:@"UpdatedQuantity"]
+       forComponentID:[[notification userInfo] objectForKey:@"UpdatedComponentID"]];
+}
+
+
+- (void)kitWithdrawnNotification:(NSNotification *)notification {
+    NSDictionary<NSNumber *, NSNumber *> *updatedQuantities = [[notification userInfo] objectForKey:@"UpdatedQuantities"];
+    [updatedQuantities enumerateKeysAndObjectsUsingBlock:^(NSNumber *componentID, NSNumber *quantity, BOOL *stop) {
+        [self setQuantity:quantity forComponentID:componentID];
+    }];
+}
+
+
+- (void)componentRegisteredNotification:(NSNotification *)notification {
+    [self reloadComponentID:[[notification userInfo] objectForKey:@"ComponentID"]];
+}
+
+
+- (void)componentRemovedNotification:(NSNotification *)notification {
+    [self removeComponentID:[[notification userInfo] objectForKey:@"ComponentID"]];
+}
+
+@end
@@ -0,0 +1,38 @@
+//
+//  CombinationFinder.h
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ Finds two or three stocked values whose sum, or whose reciprocal sum, lands within a tolerance
+ of a target: series and parallel networks of resistors, or parallel and series networks of
+ capacitors. Reciprocal networks are searched as sums of reciprocals, so both use one search
+ over a sorted array: the smallest part is bounded by a share of the target, a pair's partner is
+ found by binary search and a triple's last part by a pointer swept against the middle one.
+ Ranges of the smallest part are searched concurrently.
+ */
+@interface CombinationFinder : NSObject
+
+/*
+ Values must be distinct, positive and ascending, with the units in stock of each in quantities;
+ a value is used twice or three times only if enough units exist. Tolerance is in percent. Each
+ result holds the part "values", whether they are "additive" or combine reciprocally, the
+ resulting "value" and its "deviation" from the target in percent, best first.
+ */
++ (NSArray<NSDictionary *> *)combinationsOfValues:(NSArray<NSNumber *> *)values
+                                       quantities:(NSArray<NSNumber *> *)quantities
+                                           target:(double)target
+                                        tolerance:(double)tolerance
+                                  includesTriples:(BOOL)includesTriples
+                                            limit:(NSUInteger)limit;
+
+@end
+
+NS_ASSUME_NONNULL_END
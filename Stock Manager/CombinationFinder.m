@@ -0,0 +1,277 @@
+//
+//  CombinationFinder.m
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import "CombinationFinder.h"
+
+#define MAX_PARTS 3
+#define CHUNKS_PER_CORE 8 //Small first parts have the most partners, so they are dealt out in interleaved chunks
+
+typedef struct {
+    size_t indexes[MAX_PARTS]; //Into the search space's terms, ascending
+    int partCount;
+    double error; //Of the combined value relative to the target
+} Combination;
+
+typedef struct {
+    Combination *items; //Best first
+    size_t count;
+    size_t limit;
+} Ranking;
+
+typedef struct {
+    const double *terms;        //Ascending: the values, or the reciprocals of the values in reverse order
+    const int64_t *quantities;  //Units in stock behind each term
+    size_t count;
+    double target;              //Sum of terms sought
+    double lower;               //Range of acceptable sums
+    double upper;
+    BOOL additive;              //Terms are the values themselves
+} SearchSpace;
+
+
+static BOOL isBetter(const Combination *candidate, const Combination *other) {
+    double candidateError = fabs(candidate->error);
+    double otherError = fabs(other->error);
+    return candidateError < otherError || (candidateError == otherError && candidate->partCount < other->partCount);
+}
+
+
+// Insertion into a short sorted array; limits are a few tens of entries
+static void rankCombination(Ranking *ranking, const Combination *candidate) {
+    if (ranking->count == ranking->limit && !isBetter(candidate, &ranking->items[ranking->count - 1])) {
+        return;
+    }
+    size_t position = ranking->count < ranking->limit ? ranking->count++ : ranking->count - 1;
+    while (position > 0 && isBetter(candidate, &ranking->items[position - 1])) {
+        ranking->items[position] = ranking->items[position - 1];
+        position--;
+    }
+    ranking->items[position] = *candidate;
+}
+
+
+// First index in [start, count) whose term is not below the key
+static size_t lowerBound(const double *terms, size_t start, size_t count, double key) {
+    size_t low = start;
+    size_t high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (terms[middle] < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+
+// Error of the combined value, which for reciprocal terms is the reciprocal of their sum
+static double errorOfSum(const SearchSpace *space, double sum) {
+    return space->additive ? sum / space->target - 1.0 : space->target / sum - 1.0;
+}
+
+
+// Sums that could still enter the ranking: the tolerance until it fills, then the error of its last entry
+static void getRankableSums(const SearchSpace *space, const Ranking *ranking, double *lower, double *upper) {
+    *lower = space->lower;
+    *upper = space->upper;
+    if (ranking->count < ranking->limit) {
+        return;
+    }
+    double error = fabs(ranking->items[ranking->count - 1].error);
+    if (space->additive) {
+        *lower = MAX(*lower, space->target * (1.0 - error));
+        *upper = MIN(*upper, space->target * (1.0 + error));
+    } else {
+        *lower = MAX(*lower, space->target / (1.0 + error));
+        *upper = error < 1.0 ? MIN(*upper, space->target / (1.0 - error)) : *upper;
+    }
+}
+
+
+static void considerCombination(const SearchSpace *space, Ranking *ranking, const size_t *indexes, int partCount) {
+    double sum = 0.0;
+    for (int part = 0; part < partCount; part++) {
+        sum += space->terms[indexes[part]];
+    }
+    if (sum < space->lower || sum > space->upper) {
+        return;
+    }
+    // Parts are ascending, so a value used more than once repeats at adjacent positions
+    for (int part = 0; part < partCount; part++) {
+        int uses = 1;
+        while (part + 1 < partCount && indexes[part + 1] == indexes[part]) {
+            uses++;
+            part++;
+        }
+        if (space->quantities[indexes[part]] < uses) {
+            return;
+        }
+    }
+    Combination combination;
+    memcpy(combination.indexes, indexes, partCount * sizeof(size_t));
+    combination.partCount = partCount;
+    combination.error = errorOfSum(space, sum);
+    rankCombination(ranking, &combination);
+}
+
+
+static void searchPairs(const SearchSpace *space, Ranking *ranking, size_t first) {
+    const double *terms = space->terms;
+    double remainder = space->target - terms[first];
+    // Partners walk outward from the remainder, smallest error first, so no more than the limit can rank
+    size_t above = lowerBound(terms, first, space->count, remainder);
+    size_t below = above;
+    for (size_t taken = 0; taken < ranking->limit; taken++) {
+        BOOL hasAbove = above < space->count && terms[first] + terms[above] <= space->upper;
+        BOOL hasBelow = below > first && terms[first] + terms[below - 1] >= space->lower;
+        if (!hasAbove && !hasBelow) {
+            break;
+        }
+        size_t second = 0;
+        if (hasAbove && (!hasBelow || fabs(errorOfSum(space, terms[first] + terms[above])) <= fabs(errorOfSum(space, terms[first] + terms[below - 1])))) {
+            second = above++;
+        } else {
+            second = --below;
+        }
+        size_t indexes[2] = { first, second };
+        considerCombination(space, ranking, indexes, 2);
+    }
+}
+
+
+static void searchTriples(const SearchSpace *space, Ranking *ranking, size_t first) {
+    const double *terms = space->terms;
+    // Below this second part even the largest third can't reach the range
+    size_t second = lowerBound(terms, first, space->count, space->lower - terms[first] - terms[space->count - 1]);
+    if (second == space->count) {
+        return;
+    }
+    // First third part not below the remainder; the remainder falls as the second part grows, so it only moves down
+    size_t third = lowerBound(terms, second, space->count, space->target - terms[first] - terms[second]);
+    double lower = 0.0;
+    double upper = 0.0;
+    getRankableSums(space, ranking, &lower, &upper);
+    for (; second < space->count; second++) {
+        double partial = terms[first] + terms[second];
+        // The third part is at least the second, so larger second parts only overshoot
+        if (partial + terms[second] > space->upper) {
+            break;
+        }
+        double remainder = space->target - partial;
+        while (third > second && terms[third - 1] >= remainder) {
+            third--;
+        }
+        third = MAX(third, second);
+        // The range narrows as the ranking improves, so most pairs are rejected here in a few instructions
+        if (third < space->count && partial + terms[third] <= upper) {
+            size_t indexes[3] = { first, second, third };
+            considerCombination(space, ranking, indexes, 3);
+            getRankableSums(space, ranking, &lower, &upper);
+        }
+        if (third > second && partial + terms[third - 1] >= lower) {
+            size_t indexes[3] = { first, second, third - 1 };
+            considerCombination(space, ranking, indexes, 3);
+            getRankableSums(space, ranking, &lower, &upper);
+        }
+    }
+}
+
+
+static void searchSpace(const SearchSpace *space, BOOL includesTriples, Ranking *ranking) {
+    size_t chunkCount = [[NSProcessInfo processInfo] activeProcessorCount] * CHUNKS_PER_CORE;
+    Ranking *chunkRankings = calloc(chunkCount, sizeof(Ranking));
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+        chunkRankings[chunk].items = malloc(ranking->limit * sizeof(Combination));
+        chunkRankings[chunk].limit = ranking->limit;
+    }
+    dispatch_apply(chunkCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t chunk) {
+        Ranking *chunkRanking = &chunkRankings[chunk];
+        // Parts are ascending, so the first is at most half the sum of a pair and a third of a triple's
+        for (size_t first = chunk; first < space->count && 2.0 * space->terms[first] <= space->upper; first += chunkCount) {
+            searchPairs(space, chunkRanking, first);
+            if (includesTriples && 3.0 * space->terms[first] <= space->upper) {
+                searchTriples(space, chunkRanking, first);
+            }
+        }
+    });
+    for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+        for (size_t i = 0; i < chunkRankings[chunk].count; i++) {
+            rankCombination(ranking, &chunkRankings[chunk].items[i]);
+        }
+        free(chunkRankings[chunk].items);
+    }
+    free(chunkRankings);
+}
+
+@implementation CombinationFinder
+
++ (NSArray<NSDictionary *> *)combinationsOfValues:(NSArray<NSNumber *> *)values
+                                       quantities:(NSArray<NSNumber *> *)quantities
+                                           target:(double)target
+                                        tolerance:(double)tolerance
+                                  includesTriples:(BOOL)includesTriples
+                                            limit:(NSUInteger)limit {
+    size_t count = [values count];
+    if (count == 0 || limit == 0 || !(target > 0.0)) {
+        return @[];
+    }
+    double *ascendingValues = malloc(count * sizeof(double));
+    double *reciprocals = malloc(count * sizeof(double));
+    int64_t *units = malloc(count * sizeof(int64_t));
+    int64_t *reversedUnits = malloc(count * sizeof(int64_t));
+    for (size_t i = 0; i < count; i++) {
+        ascendingValues[i] = [values[i] doubleValue];
+        units[i] = [quantities[i] longLongValue];
+        reciprocals[count - 1 - i] = 1.0 / ascendingValues[i];
+        reversedUnits[count - 1 - i] = units[i];
+    }
+    double fraction = tolerance / 100.0;
+    SearchSpace additiveSpace = { ascendingValues, units, count, target, target * (1.0 - fraction), target * (1.0 + fraction), YES };
+    SearchSpace reciprocalSpace = {
+        reciprocals, reversedUnits, count, 1.0 / target,
+        1.0 / (target * (1.0 + fraction)), fraction < 1.0 ? 1.0 / (target * (1.0 - fraction)) : INFINITY, NO
+    };
+    Ranking additiveRanking = { malloc(limit * sizeof(Combination)), 0, limit };
+    Ranking reciprocalRanking = { malloc(limit * sizeof(Combination)), 0, limit };
+    searchSpace(&additiveSpace, includesTriples, &additiveRanking);
+    searchSpace(&reciprocalSpace, includesTriples, &reciprocalRanking);
+    // Merge the two rankings, mapping reciprocal terms back to ascending values
+    NSMutableArray<NSDictionary *> *combinations = [[NSMutableArray alloc] initWithCapacity:limit];
+    size_t additiveNext = 0;
+    size_t reciprocalNext = 0;
+    while ([combinations count] < limit && (additiveNext < additiveRanking.count || reciprocalNext < reciprocalRanking.count)) {
+        BOOL additive = reciprocalNext == reciprocalRanking.count
+            || (additiveNext < additiveRanking.count && !isBetter(&reciprocalRanking.items[reciprocalNext], &additiveRanking.items[additiveNext]));
+        const Combination *combination = additive ? &additiveRanking.items[additiveNext++] : &reciprocalRanking.items[reciprocalNext++];
+        NSMutableArray<NSNumber *> *partValues = [[NSMutableArray alloc] initWithCapacity:combination->partCount];
+        double sum = 0.0;
+        for (int part = 0; part < combination->partCount; part++) {
+            size_t index = additive ? combination->indexes[part] : count - 1 - combination->indexes[combination->partCount - 1 - part];
+            [partValues addObject:[NSNumber numberWithDouble:ascendingValues[index]]];
+            sum += additive ? ascendingValues[index] : 1.0 / ascendingValues[index];
+        }
+        double value = additive ? sum : 1.0 / sum;
+        [combinations addObject:@{
+            @"values" : partValues,
+            @"additive" : [NSNumber numberWithBool:additive],
+            @"value" : [NSNumber numberWithDouble:value],
+            @"deviation" : [NSNumber numberWithDouble:(value / target - 1.0) * 100.0]
+        }];
+    }
+    free(additiveRanking.items);
+    free(reciprocalRanking.items);
+    free(ascendingValues);
+    free(reciprocals);
+    free(units);
+    free(reversedUnits);
+    return combinations;
+}
+
+@end
@@ -0,0 +1,27 @@
+//
+//  CompletionIndex.h
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ Prefix-searchable set of names serving an NSComboBox through its data source.
+ Names are kept sorted by their case and diacritic folded form, so the names sharing a
+ prefix form one contiguous range found by binary search. Completion picks the most used
+ name in that range.
+ */
+@interface CompletionIndex : NSObject <NSComboBoxDataSource>
+
+- (instancetype)initWithUsageCounts:(NSDictionary<NSString *, NSNumber *> *)usageCounts;
+- (NSRange)rangeOfNamesWithPrefix:(NSString *)prefix;
+- (nullable NSString *)bestCompletionForPrefix:(NSString *)prefix;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,137 @@
+//
+//  CompletionIndex.m
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import "CompletionIndex.h"
+
+@interface CompletionIndex ()
+
+@property NSArray<NSString *> *names;
+@property NSArray<NSString *> *keys; //Folded names, in the same order
+@property NSUInteger count;
+
+@end
+
+@implementation CompletionIndex {
+    NSUInteger *_usageCounts;
+}
+
+- (instancetype)initWithUsageCounts:(NSDictionary<NSString *, NSNumber *> *)usageCounts {
+    self = [super init];
+    if (self) {
+        _count = [usageCounts count];
+        NSMutableArray<NSString *> *unsortedKeys = [[NSMutableArray alloc] initWithCapacity:_count];
+        NSArray<NSString *> *unsortedNames = [usageCounts allKeys];
+        for (NSString *name in unsortedNames) {
+            [unsortedKeys addObject:[CompletionIndex keyForString:name]];
+        }
+        NSMutableArray<NSNumber *> *order = [[NSMutableArray alloc] initWithCapacity:_count];
+        for (NSUInteger i = 0; i < _count; i++) {
+            [order addObject:[NSNumber numberWithUnsignedInteger:i]];
+        }
+        [order sortUsingComparator:^NSComparisonResult(NSNumber *left, NSNumber *right) {
+            return [unsortedKeys[[left unsignedIntegerValue]] compare:unsortedKeys[[right unsignedIntegerValue]]
+                                                             options:NSLiteralSearch];
+        }];
+        NSMutableArray<NSString *> *names = [[NSMutableArray alloc] initWithCapacity:_count];
+        NSMutableArray<NSString *> *keys = [[NSMutableArray alloc] initWithCapacity:_count];
+        _usageCounts = calloc(MAX(_count, 1), sizeof(NSUInteger));
+        for (NSUInteger i = 0; i < _count; i++) {
+            NSUInteger position = [order[i] unsignedIntegerValue];
+            [names addObject:unsortedNames[position]];
+            [keys addObject:unsortedKeys[position]];
+            _usageCounts[i] = [[usageCounts objectForKey:unsortedNames[position]] unsignedIntegerValue];
+        }
+        _names = [names copy];
+        _keys = [keys copy];
+    }
+    return self;
+}
+
+
+- (void)dealloc {
+    free(_usageCounts);
+}
+
+
++ (NSString *)keyForString:(NSString *)string {
+    return [string stringByFoldingWithOptions:NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch locale:nil];
+}
+
+
+- (NSRange)rangeOfNamesWithPrefix:(NSString *)prefix {
+    NSString *key = [CompletionIndex keyForString:prefix];
+    // First key not ordered before the prefix
+    NSUInteger low = 0;
+    NSUInteger high = _count;
+    while (low < high) {
+        NSUInteger middle = low + (high - low) / 2;
+        if ([_keys[middle] compare:key options:NSLiteralSearch] == NSOrderedAscending) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    NSUInteger start = low;
+    // Keys sharing the prefix are contiguous, so the first one without it ends the range
+    high = _count;
+    while (low < high) {
+        NSUInteger middle = low + (high - low) / 2;
+        if ([_keys[middle] hasPrefix:key]) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return NSMakeRange(start, low - start);
+}
+
+
+- (nullable NSString *)bestCompletionForPrefix:(NSString *)prefix {
+    NSRange range = [self rangeOfNamesWithPrefix:prefix];
+    if (range.length == 0) {
+        return nil;
+    }
+    // Most used name wins; ties go to the first in sort order
+    NSUInteger best = range.location;
+    for (NSUInteger i = range.location + 1; i < NSMaxRange(range); i++) {
+        if (_usageCounts[i] > _usageCounts[best]) {
+            best = i;
+        }
+    }
+    return _names[best];
+}
+
+#pragma mark - NSComboBoxDataSource
+
+- (NSInteger)numberOfItemsInComboBox:(NSComboBox *)comboBox {
+    return _count;
+}
+
+
+- (id)comboBox:(NSComboBox *)comboBox objectValueForItemAtIndex:(NSInteger)index {
+    return _names[index];
+}
+
+
+- (NSUInteger)comboBox:(NSComboBox *)comboBox indexOfItemWithStringValue:(NSString *)string {
+    NSRange range = [self rangeOfNamesWithPrefix:string];
+    if (range.length > 0 && [_keys[range.location] isEqualToString:[CompletionIndex keyForString:string]]) {
+        return range.location;
+    }
+    return NSNotFound;
+}
+
+
+- (nullable NSString *)comboBox:(NSComboBox *)comboBox completedString:(NSString *)string {
+    if ([string length] == 0) {
+        return nil;
+    }
+    return [self bestCompletionForPrefix:string];
+}
+
+@end
@@ -10,6 +10,44 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+typedef NS_ENUM(NSInteger, ComponentRatingKind) {
+    ComponentRatingKindUnknown = -1, //No unit was written
+    ComponentRatingKindVoltage,      //Same order as ratingNames
+    ComponentRatingKindCurrent,
+    ComponentRatingKindPower,
+    ComponentRatingKindResistance,
+    ComponentRatingKindInductance,
+    ComponentRatingKindCapacitance,
+    ComponentRatingKindFrequency,
+    ComponentRatingKindTolerance
+};
+
+typedef struct {
+    double value; //In base units
+    ComponentRatingKind kind;
+    BOOL hasMultiplier; //A prefix or RKM radix was written, so the value is complete without a selected unit
+} ComponentRatingParseResult;
+
+/*
+ Parses engineering notation from UTF-8 text without allocating: "4.7k", "4k7", "2u2", "100nF",
+ "1R5", "R47", "10 kΩ", "5%". Prefixes come from the same table the ratings are displayed with,
+ accepting u and μ for µ and K for k. Returns NO unless the whole text is one value.
+ */
+BOOL ComponentRatingParse(const char *text, size_t length, ComponentRatingParseResult *result);
+
+/*
+ Writes a value in engineering notation as ratings are displayed, "4.7 kΩ", or as "5%" for the
+ percent sign, always with a point for the decimal separator so the text depends on nothing else.
+ Returns the length of the whole text, as snprintf does.
+ */
+int ComponentRatingFormat(double value, const char *unitSymbol, char *buffer, size_t size);
+
+/*
+ Position of a value within its decade of the IEC 60063 series with the given number of values
+ per decade (3, 6, 12, 24, 48, 96 or 192), so 4.7k is 8 in E12. Returns -1 if the value isn't in it.
+ */
+NSInteger ComponentRatingESeriesIndex(double value, NSInteger series);
+
 @interface ComponentRating : NSObject
 
 @property (readonly) NSNumber *significand;
@@ -19,6 +57,9 @@ NS_ASSUME_NONNULL_BEGIN
 
 + (NSArray<NSString *> *)ratingNames;
 + (BOOL)magnitude:(NSInteger *)magnitude forPrefix:(NSString *)prefix;
++ (BOOL)parseString:(NSString *)string result:(ComponentRatingParseResult *)result;
++ (nullable Class)ratingClassForKind:(ComponentRatingKind)kind;
++ (nullable NSString *)columnNameForKind:(ComponentRatingKind)kind;
 
 - (instancetype)initWithValue:(double)value;
 - (void)setValue:(double)value;
@@ -8,6 +8,262 @@
 
 #import "ComponentRating.h"
 
+#define UNPREFIXED_INDEX 5
+#define MAX_MANTISSA_DIGITS 18 //Further digits only scale the value, keeping the mantissa exact in 64 bits
+#define MAX_STACK_TEXT_LENGTH 64
+
+// Metric prefixes as UTF-8, from 10^-15 to 10^15 in steps of 10^3
+static const char *const metricPrefixes[] = {
+    "f",    //10^-15
+    "p",    //10^-12
+    "n",    //10^-9
+    "µ",    //10^-6
+    "m",    //10^-3
+    "",     //10^0
+    "k",    //10^3
+    "M",    //10^6
+    "G",    //10^9
+    "T",    //10^12
+    "P"     //10^15
+};
+#define METRIC_PREFIX_COUNT (sizeof(metricPrefixes) / sizeof(metricPrefixes[0]))
+
+// Spellings accepted on input besides the table's own
+static const struct { const char *alias; size_t prefixIndex; } prefixAliases[] = {
+    { "u", 3 },
+    { "μ", 3 }, //Greek small letter mu, as opposed to the micro sign
+    { "K", 6 }
+};
+
+// Longer symbols first, so "Hz" is not read as "H" and "ohms" not as "ohm"
+static const struct { const char *symbol; ComponentRatingKind kind; } unitSymbols[] = {
+    { "Hz", ComponentRatingKindFrequency },
+    { "ohms", ComponentRatingKindResistance },
+    { "ohm", ComponentRatingKindResistance },
+    { "Ω", ComponentRatingKindResistance },
+    { "Ω", ComponentRatingKindResistance }, //Ohm sign
+    { "V", ComponentRatingKindVoltage },
+    { "A", ComponentRatingKindCurrent },
+    { "W", ComponentRatingKindPower },
+    { "H", ComponentRatingKindInductance },
+    { "F", ComponentRatingKindCapacitance },
+    { "%", ComponentRatingKindTolerance }
+};
+
+static const double powersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static size_t matchSymbol(const char *cursor, const char *end, const char *symbol) {
+    size_t length = strlen(symbol);
+    if (length == 0 || (size_t)(end - cursor) < length || memcmp(cursor, symbol, length) != 0) {
+        return 0;
+    }
+    return length;
+}
+
+
+// Returns the length matched and sets the table index, or returns 0 when no prefix starts here
+static size_t matchPrefix(const char *cursor, const char *end, size_t *prefixIndex) {
+    for (size_t i = 0; i < METRIC_PREFIX_COUNT; i++) {
+        size_t length = matchSymbol(cursor, end, metricPrefixes[i]);
+        if (length > 0) {
+            *prefixIndex = i;
+            return length;
+        }
+    }
+    for (size_t i = 0; i < sizeof(prefixAliases) / sizeof(prefixAliases[0]); i++) {
+        size_t length = matchSymbol(cursor, end, prefixAliases[i].alias);
+        if (length > 0) {
+            *prefixIndex = prefixAliases[i].prefixIndex;
+            return length;
+        }
+    }
+    return 0;
+}
+
+
+static double scaleByPowerOfTen(double value, int exponent) {
+    int magnitude = abs(exponent);
+    double scale = magnitude < (int)(sizeof(powersOfTen) / sizeof(powersOfTen[0])) ? powersOfTen[magnitude] : pow(10.0, magnitude);
+    // Dividing by an exact power keeps "4.7" and "4k7" from picking up representation error
+    return exponent < 0 ? value / scale : value * scale;
+}
+
+
+BOOL ComponentRatingParse(const char *text, size_t length, ComponentRatingParseResult *result) {
+    const char *cursor = text;
+    const char *end = text + length;
+    uint64_t mantissa = 0;
+    int mantissaDigits = 0;
+    int exponent = 0;
+    BOOL sawDigit = NO;
+    BOOL sawPoint = NO;
+    size_t prefixIndex = UNPREFIXED_INDEX;
+    ComponentRatingKind kind = ComponentRatingKindUnknown;
+    BOOL hasMultiplier = NO;
+    while (cursor < end && *cursor == ' ') {
+        cursor++;
+    }
+    // Integer digits, then a decimal point or an RKM radix (a prefix or R standing in for the point)
+    for (int part = 0; part < 2; part++) {
+        while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+            if (mantissaDigits < MAX_MANTISSA_DIGITS) {
+                mantissa = mantissa * 10 + (uint64_t)(*cursor - '0');
+                mantissaDigits += mantissa > 0;
+                exponent -= part;
+            } else {
+                exponent += 1 - part;
+            }
+            sawDigit = YES;
+            cursor++;
+        }
+        if (part == 1 || cursor == end) {
+            break;
+        }
+        if (*cursor == '.') {
+            sawPoint = YES;
+            cursor++;
+            continue;
+        }
+        size_t radixLength = (*cursor == 'R' || *cursor == 'r') ? 1 : matchPrefix(cursor, end, &prefixIndex);
+        if (radixLength == 0 || cursor + radixLength == end || cursor[radixLength] < '0' || cursor[radixLength] > '9') {
+            prefixIndex = UNPREFIXED_INDEX;
+            break;
+        }
+        if (*cursor == 'R' || *cursor == 'r') {
+            kind = ComponentRatingKindResistance;
+        }
+        hasMultiplier = YES;
+        cursor += radixLength;
+    }
+    if (!sawDigit) {
+        return NO;
+    }
+    while (cursor < end && *cursor == ' ') {
+        cursor++;
+    }
+    if (!hasMultiplier && cursor < end) {
+        size_t prefixLength = matchPrefix(cursor, end, &prefixIndex);
+        if (prefixLength > 0) {
+            hasMultiplier = YES;
+            cursor += prefixLength;
+        } else if (!sawPoint && (*cursor == 'R' || *cursor == 'r')) {
+            // "100R" is RKM for 100 Ω with nothing after the radix
+            kind = ComponentRatingKindResistance;
+            hasMultiplier = YES;
+            cursor++;
+        }
+    }
+    for (size_t i = 0; cursor < end && i < sizeof(unitSymbols) / sizeof(unitSymbols[0]); i++) {
+        size_t symbolLength = matchSymbol(cursor, end, unitSymbols[i].symbol);
+        if (symbolLength > 0) {
+            if (kind != ComponentRatingKindUnknown && kind != unitSymbols[i].kind) {
+                return NO; //"1R5F"
+            }
+            kind = unitSymbols[i].kind;
+            cursor += symbolLength;
+            break;
+        }
+    }
+    while (cursor < end && *cursor == ' ') {
+        cursor++;
+    }
+    if (cursor != end) {
+        return NO;
+    }
+    int prefixExponent = 3 * ((int)prefixIndex - UNPREFIXED_INDEX);
+    result->value = scaleByPowerOfTen((double)mantissa, exponent + prefixExponent);
+    result->kind = kind;
+    result->hasMultiplier = hasMultiplier;
+    return YES;
+}
+
+int ComponentRatingFormat(double value, const char *unitSymbol, char *buffer, size_t size) {
+    if (strcmp(unitSymbol, "%") == 0) {
+        return snprintf(buffer, size, "%g%%", value);
+    }
+    double magnitude = fabs(value);
+    int group = magnitude > 0.0 ? (int)floor(log10(magnitude) / 3) : 0;
+    double significand = scaleByPowerOfTen(magnitude, -3 * group);
+    // Rounding to four decimals may carry into the next prefix, as 999.99995 into 1 k
+    if (significand >= 999.99995) {
+        group++;
+        significand = scaleByPowerOfTen(magnitude, -3 * group);
+    }
+    int prefixIndex = group + UNPREFIXED_INDEX;
+    if (!isfinite(magnitude) || prefixIndex < 0 || prefixIndex >= (int)METRIC_PREFIX_COUNT) {
+        return snprintf(buffer, size, "%g %s", value, unitSymbol);
+    }
+    char digits[32];
+    int length = snprintf(digits, sizeof(digits), "%.4f", significand);
+    while (length > 0 && digits[length - 1] == '0') {
+        length--;
+    }
+    if (length > 0 && digits[length - 1] == '.') {
+        length--;
+    }
+    return snprintf(buffer, size, "%s%.*s %s%s", value < 0.0 ? "-" : "", length, digits, metricPrefixes[prefixIndex], unitSymbol);
+}
+
+// IEC 60063 values per decade; E3, E6 and E12 take every 8th, 4th and 2nd E24 value, E48 and E96 every 4th and 2nd E192 value
+static const double e24Values[24] = {
+    1.0, 1.1, 1.2, 1.3, 1.5, 1.6, 1.8, 2.0, 2.2, 2.4, 2.7, 3.0,
+    3.3, 3.6, 3.9, 4.3, 4.7, 5.1, 5.6, 6.2, 6.8, 7.5, 8.2, 9.1
+};
+
+static const double e192Values[192] = {
+    100, 101, 102, 104, 105, 106, 107, 109, 110, 111, 113, 114, 115, 117, 118, 120,
+    121, 123, 124, 126, 127, 129, 130, 132, 133, 135, 137, 138, 140, 142, 143, 145,
+    147, 149, 150, 152, 154, 156, 158, 160, 162, 164, 165, 167, 169, 172, 174, 176,
+    178, 180, 182, 184, 187, 189, 191, 193, 196, 198, 200, 203, 205, 208, 210, 213,
+    215, 218, 221, 223, 226, 229, 232, 234, 237, 240, 243, 246, 249, 252, 255, 258,
+    261, 264, 267, 271, 274, 277, 280, 284, 287, 291, 294, 298, 301, 305, 309, 312,
+    316, 320, 324, 328, 332, 336, 340, 344, 348, 352, 357, 361, 365, 370, 374, 379,
+    383, 388, 392, 397, 402, 407, 412, 417, 422, 427, 432, 437, 442, 448, 453, 459,
+    464, 470, 475, 481, 487, 493, 499, 505, 511, 517, 523, 530, 536, 542, 549, 556,
+    562, 569, 576, 583, 590, 597, 604, 612, 619, 626, 634, 642, 649, 657, 665, 673,
+    681, 690, 698, 706, 715, 723, 732, 741, 750, 759, 768, 777, 787, 796, 806, 816,
+    825, 835, 845, 856, 866, 876, 887, 898, 909, 920, 931, 942, 953, 965, 976, 988
+};
+#define E_SERIES_MATCH_TOLERANCE 1e-6 //Relative, absorbing the rounding of the decade scaling
+
+
+NSInteger ComponentRatingESeriesIndex(double value, NSInteger series) {
+    const double *table = NULL;
+    NSInteger tableCount = 0;
+    double tableScale = 1.0;
+    if (series == 3 || series == 6 || series == 12 || series == 24) {
+        table = e24Values;
+        tableCount = 24;
+    } else if (series == 48 || series == 96 || series == 192) {
+        table = e192Values;
+        tableCount = 192;
+        tableScale = 100.0;
+    } else {
+        return -1;
+    }
+    if (!(value > 0.0) || !isfinite(value)) {
+        return -1;
+    }
+    NSInteger step = tableCount / series;
+    double mantissa = value / pow(10.0, floor(log10(value))) * tableScale;
+    // Preferred numbers are rounded from a geometric progression, so the match is at the estimate or beside it
+    NSInteger estimate = lround(log10(mantissa / tableScale) * tableCount);
+    for (NSInteger i = estimate - 1; i <= estimate + 1; i++) {
+        // Past either end of the table the neighbouring decade's first or last value is compared
+        NSInteger position = (i % tableCount + tableCount) % tableCount;
+        double candidate = table[position] * (i < 0 ? 0.1 : (i >= tableCount ? 10.0 : 1.0));
+        if (position % step == 0 && fabs(mantissa - candidate) <= candidate * E_SERIES_MATCH_TOLERANCE) {
+            return position / step;
+        }
+    }
+    return -1;
+}
+
+#pragma mark -
+
 @interface ComponentRating ()
 
 @property (readwrite) NSNumber *significand;
@@ -40,19 +296,11 @@
 + (NSArray *)prefixes {
     static NSArray *prefixes = nil;
     if (!prefixes) {
-        prefixes = @[
-            @"f",   //10^-15
-            @"p",   //10^-12
-            @"n",   //10^-9
-            @"µ",   //10^-6
-            @"m",   //10^-3
-            @"",    //10^0
-            @"k",   //10^3
-            @"M",   //10^6
-            @"G",   //10^9
-            @"T",   //10^12
-            @"P"    //10^15
-        ];
+        NSMutableArray *symbols = [[NSMutableArray alloc] initWithCapacity:METRIC_PREFIX_COUNT];
+        for (size_t i = 0; i < METRIC_PREFIX_COUNT; i++) {
+            [symbols addObject:[NSString stringWithUTF8String:metricPrefixes[i]]];
+        }
+        prefixes = [symbols copy];
     }
     return prefixes;
 }
@@ -78,6 +326,43 @@
 }
 
 
++ (BOOL)parseString:(NSString *)string result:(ComponentRatingParseResult *)result {
+    // Borrow the string's own UTF-8 storage when it has one, otherwise copy onto the stack
+    const char *text = CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingUTF8);
+    char buffer[MAX_STACK_TEXT_LENGTH];
+    if (!text) {
+        if (![string getCString:buffer maxLength:sizeof(buffer) encoding:NSUTF8StringEncoding]) {
+            return NO;
+        }
+        text = buffer;
+    }
+    return ComponentRatingParse(text, strlen(text), result);
+}
+
+
++ (nullable Class)ratingClassForKind:(ComponentRatingKind)kind {
+    switch (kind) {
+        case ComponentRatingKindVoltage:        return [VoltageRating class];
+        case ComponentRatingKindCurrent:        return [CurrentRating class];
+        case ComponentRatingKindPower:          return [PowerRating class];
+        case ComponentRatingKindResistance:     return [ResistanceRating class];
+        case ComponentRatingKindInductance:     return [InductanceRating class];
+        case ComponentRatingKindCapacitance:    return [CapacitanceRating class];
+        case ComponentRatingKindFrequency:      return [FrequencyRating class];
+        case ComponentRatingKindTolerance:      return [ToleranceRating class];
+        case ComponentRatingKindUnknown:        return nil;
+    }
+}
+
+
++ (nullable NSString *)columnNameForKind:(ComponentRatingKind)kind {
+    if (kind < 0 || kind >= (NSInteger)[[ComponentRating ratingNames] count]) {
+        return nil;
+    }
+    return [[[ComponentRating ratingNames][kind] lowercaseString] stringByAppendingString:@"_rating"];
+}
+
+
 + (NSNumberFormatter *)numberFormatter {
     static NSNumberFormatter *formatter = nil;
     if (!formatter) {
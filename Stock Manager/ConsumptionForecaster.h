@@ -0,0 +1,32 @@
+//
+//  ConsumptionForecaster.h
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+@class FMDatabase;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ Keeps exponentially decayed sums of each component's expenditures over 30, 90 and 365 day
+ windows in the consumption_rates table. A sum decays by e^(-elapsed/window) and divided by
+ the window length gives the daily usage. Each withdrawal folds into its component's row in
+ O(1), so forecasts never read the expenditures history.
+ */
+@interface ConsumptionForecaster : NSObject
+
++ (BOOL)recordExpenditureOfQuantity:(NSInteger)quantity
+                        componentID:(NSNumber *)componentID
+                               date:(nullable NSDate *)date
+                         inDatabase:(FMDatabase *)database;
++ (BOOL)rebuildConsumptionRatesInDatabase:(FMDatabase *)database;
++ (NSArray<NSDictionary *> *)forecastsRunningOutSoonestInDatabase:(FMDatabase *)database
+                                                            limit:(NSUInteger)limit;
+
+@end
+
+NS_ASSUME_NONNULL_END
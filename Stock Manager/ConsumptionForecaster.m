@@ -0,0 +1,133 @@
+//
+//  ConsumptionForecaster.m
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import "ConsumptionForecaster.h"
+#import "FMDB.h"
+
+#define WINDOW_COUNT 3
+#define FORECAST_WINDOW 1 //Days remaining are estimated from the 90 day usage
+#define SECONDS_PER_DAY 86400.0
+#define MINIMUM_DAILY_USAGE 1e-6 //Below this a component isn't considered to be consumed
+
+static const double windowDays[WINDOW_COUNT] = { 30.0, 90.0, 365.0 };
+
+typedef struct {
+    double usage[WINDOW_COUNT]; //Decayed sums as of the reference time
+    double referenceTime;       //Seconds since 1970
+} ConsumptionState;
+
+static void addExpenditure(ConsumptionState *state, double quantity, double time) {
+    for (int i = 0; i < WINDOW_COUNT; i++) {
+        double window = windowDays[i] * SECONDS_PER_DAY;
+        if (time >= state->referenceTime) {
+            state->usage[i] = state->usage[i] * exp(-(time - state->referenceTime) / window) + quantity;
+        } else {
+            // Backdated expenditure: decay it to the reference time instead of moving the reference back
+            state->usage[i] += quantity * exp(-(state->referenceTime - time) / window);
+        }
+    }
+    state->referenceTime = MAX(state->referenceTime, time);
+}
+
+
+static BOOL saveState(FMDatabase *database, NSNumber *componentID, const ConsumptionState *state) {
+    return [database executeUpdate:@"INSERT INTO consumption_rates(fk_component_id, usage_30, usage_90, usage_365, reference_time) VALUES (?, ?, ?, ?, ?) ON CONFLICT(fk_component_id) DO UPDATE SET usage_30 = excluded.usage_30, usage_90 = excluded.usage_90, usage_365 = excluded.usage_365, reference_time = excluded.reference_time",
+            componentID, @(state->usage[0]), @(state->usage[1]), @(state->usage[2]), @(state->referenceTime)];
+}
+
+@implementation ConsumptionForecaster
+
++ (BOOL)recordExpenditureOfQuantity:(NSInteger)quantity
+                        componentID:(NSNumber *)componentID
+                               date:(nullable NSDate *)date
+                         inDatabase:(FMDatabase *)database {
+    double now = [[NSDate date] timeIntervalSince1970];
+    double time = date ? MIN([date timeIntervalSince1970], now) : now;
+    ConsumptionState state = { { 0.0, 0.0, 0.0 }, time };
+    FMResultSet *resultSet = [database executeQuery:@"SELECT usage_30, usage_90, usage_365, reference_time FROM consumption_rates WHERE fk_component_id = ?", componentID];
+    if ([resultSet next]) {
+        for (int i = 0; i < WINDOW_COUNT; i++) {
+            state.usage[i] = [resultSet doubleForColumnIndex:i];
+        }
+        state.referenceTime = [resultSet doubleForColumnIndex:WINDOW_COUNT];
+    }
+    [resultSet close];
+    addExpenditure(&state, (double)quantity, time);
+    return saveState(database, componentID, &state);
+}
+
+
++ (BOOL)rebuildConsumptionRatesInDatabase:(FMDatabase *)database {
+    // Single pass over the history grouped by component; expenditures with unknown dates can't be placed
+    if (![database executeUpdate:@"DELETE FROM consumption_rates"]) {
+        return NO;
+    }
+    double now = [[NSDate date] timeIntervalSince1970];
+    FMResultSet *resultSet = [database executeQuery:@"SELECT fk_component_id, quantity, date_spent FROM expenditures WHERE date_spent IS NOT NULL ORDER BY fk_component_id"];
+    NSNumber *componentID = nil;
+    ConsumptionState state = { { 0.0, 0.0, 0.0 }, 0.0 };
+    while ([resultSet next]) {
+        NSNumber *rowComponentID = [NSNumber numberWithLongLong:[resultSet longLongIntForColumnIndex:0]];
+        double quantity = [resultSet doubleForColumnIndex:1];
+        NSDate *dateSpent = [resultSet dateForColumnIndex:2];
+        if (!dateSpent) {
+            continue;
+        }
+        double time = MIN([dateSpent timeIntervalSince1970], now);
+        if (![rowComponentID isEqual:componentID]) {
+            if (componentID && !saveState(database, componentID, &state)) {
+                [resultSet close];
+                return NO;
+            }
+            componentID = rowComponentID;
+            state = (ConsumptionState){ { 0.0, 0.0, 0.0 }, time };
+        }
+        addExpenditure(&state, quantity, time);
+    }
+    [resultSet close];
+    if (componentID && !saveState(database, componentID, &state)) {
+        return NO;
+    }
+    return YES;
+}
+
+
++ (NSArray<NSDictionary *> *)forecastsRunningOutSoonestInDatabase:(FMDatabase *)database
+                                                            limit:(NSUInteger)limit {
+    // One row per consumed component; the order depends on the current time so it's computed here, not indexed
+    double now = [[NSDate date] timeIntervalSince1970];
+    NSMutableArray<NSDictionary *> *forecasts = [[NSMutableArray alloc] init];
+    FMResultSet *resultSet = [database executeQuery:@"SELECT fk_component_id, stock.quantity, usage_30, usage_90, usage_365, reference_time FROM consumption_rates JOIN stock ON stock.component_id = fk_component_id"];
+    while ([resultSet next]) {
+        double quantity = [resultSet doubleForColumnIndex:1];
+        double referenceTime = [resultSet doubleForColumnIndex:5];
+        double dailyUsage[WINDOW_COUNT];
+        for (int i = 0; i < WINDOW_COUNT; i++) {
+            double window = windowDays[i] * SECONDS_PER_DAY;
+            dailyUsage[i] = [resultSet doubleForColumnIndex:2 + i] * exp(-MAX(now - referenceTime, 0.0) / window) / windowDays[i];
+        }
+        if (dailyUsage[FORECAST_WINDOW] < MINIMUM_DAILY_USAGE) {
+            continue;
+        }
+        [forecasts addObject:@{
+            @"component_id"     : [NSNumber numberWithLongLong:[resultSet longLongIntForColumnIndex:0]],
+            @"daily_usage_30"   : @(dailyUsage[0]),
+            @"daily_usage_90"   : @(dailyUsage[1]),
+            @"daily_usage_365"  : @(dailyUsage[2]),
+            @"days_remaining"   : @(quantity / dailyUsage[FORECAST_WINDOW])
+        }];
+    }
+    [resultSet close];
+    [forecasts sortUsingDescriptors:@[[NSSortDescriptor sortDescriptorWithKey:@"days_remaining" ascending:YES]]];
+    if ([forecasts count] > limit) {
+        [forecasts removeObjectsInRange:NSMakeRange(limit, [forecasts count] - limit)];
+    }
+    return forecasts;
+}
+
+@end
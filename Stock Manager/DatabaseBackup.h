@@ -0,0 +1,38 @@
+//
+//  DatabaseBackup.h
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+@class FMDatabase;
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef void (^DatabaseBackupProgressHandler)(double progress);
+typedef void (^DatabaseBackupCompletionHandler)(BOOL success);
+
+/*
+ Copies a live database with the SQLite online backup API, a few pages per step on a background
+ queue. The source connection is only held for the duration of one step, so foreground reads and
+ writes interleave with the copy, and pages written through the same connection meanwhile are
+ carried into the backup. The copy is built beside the destination and renamed over it once
+ complete, so the destination is never left torn. Handlers are called on the main queue.
+ */
+@interface DatabaseBackup : NSObject
+
+@property (readonly) NSString *destinationPath;
+@property (readonly) double progress;
+@property (readonly, getter=isFinished) BOOL finished;
+
+- (instancetype)initWithDatabase:(FMDatabase *)database destinationPath:(NSString *)path;
+- (void)startWithProgressHandler:(nullable DatabaseBackupProgressHandler)progressHandler
+               completionHandler:(nullable DatabaseBackupCompletionHandler)completionHandler;
+- (void)cancel;
+- (void)cancelWithCompletionHandler:(dispatch_block_t)completionHandler;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,131 @@
+//
+//  DatabaseBackup.m
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import "DatabaseBackup.h"
+#import "FMDB.h"
+#import <sqlite3.h>
+
+#define PAGES_PER_STEP 64 //Each step holds the source connection, so it copies at most a few hundred KB
+#define STEP_INTERVAL_USEC 1000 //Lets foreground statements queued on the connection run between steps
+#define BUSY_RETRY_INTERVAL_USEC 10000
+#define PROGRESS_REPORT_INCREMENT 0.01
+
+@interface DatabaseBackup ()
+
+@property FMDatabase *database;
+@property (readwrite) NSString *destinationPath;
+@property (readwrite) double progress;
+@property (readwrite, getter=isFinished) BOOL finished;
+@property (getter=isCancelled) BOOL cancelled;
+@property dispatch_queue_t queue;
+@property dispatch_group_t group;
+
+@end
+
+@implementation DatabaseBackup
+
+- (instancetype)initWithDatabase:(FMDatabase *)database destinationPath:(NSString *)path {
+    self = [super init];
+    if (self) {
+        _database = database;
+        _destinationPath = [path copy];
+        dispatch_queue_attr_t attributes = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0);
+        _queue = dispatch_queue_create("DatabaseBackup", attributes);
+        _group = dispatch_group_create();
+    }
+    return self;
+}
+
+
+- (void)startWithProgressHandler:(nullable DatabaseBackupProgressHandler)progressHandler
+               completionHandler:(nullable DatabaseBackupCompletionHandler)completionHandler {
+    NSString *temporaryPath = [_destinationPath stringByAppendingString:@".partial"];
+    dispatch_group_async(_group, _queue, ^{
+        BOOL success = [self copyToPath:temporaryPath progressHandler:progressHandler];
+        if (success && rename([temporaryPath fileSystemRepresentation], [self->_destinationPath fileSystemRepresentation]) != 0) {
+            NSLog(@"Backup failed to move '%@' into place: %s", temporaryPath, strerror(errno));
+            success = NO;
+        }
+        if (!success) {
+            unlink([temporaryPath fileSystemRepresentation]);
+        }
+        [self setFinished:YES];
+        if (completionHandler) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                completionHandler(success);
+            });
+        }
+    });
+}
+
+
+- (BOOL)copyToPath:(NSString *)path progressHandler:(nullable DatabaseBackupProgressHandler)progressHandler {
+    sqlite3 *destination = NULL;
+    unlink([path fileSystemRepresentation]); //Left over from an interrupted backup
+    if (sqlite3_open_v2([path fileSystemRepresentation], &destination, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL) != SQLITE_OK) {
+        NSLog(@"Backup failed to create file '%@': %s", path, sqlite3_errmsg(destination));
+        sqlite3_close(destination);
+        return NO;
+    }
+    sqlite3_backup *backup = sqlite3_backup_init(destination, "main", [_database sqliteHandle], "main");
+    if (!backup) {
+        NSLog(@"Backup failed to start: %s", sqlite3_errmsg(destination));
+        sqlite3_close(destination);
+        return NO;
+    }
+    int result = SQLITE_OK;
+    double reportedProgress = 0.0;
+    while (![self isCancelled]) {
+        result = sqlite3_backup_step(backup, PAGES_PER_STEP);
+        if (result == SQLITE_OK) {
+            int pageCount = sqlite3_backup_pagecount(backup);
+            double progress = pageCount > 0 ? 1.0 - (double)sqlite3_backup_remaining(backup) / pageCount : 0.0;
+            [self setProgress:progress];
+            if (progressHandler && progress - reportedProgress >= PROGRESS_REPORT_INCREMENT) {
+                reportedProgress = progress;
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    progressHandler(progress);
+                });
+            }
+            usleep(STEP_INTERVAL_USEC);
+        } else if (result == SQLITE_BUSY || result == SQLITE_LOCKED) {
+            // The source is mid write transaction; try again once it commits
+            usleep(BUSY_RETRY_INTERVAL_USEC);
+        } else {
+            break;
+        }
+    }
+    sqlite3_backup_finish(backup);
+    BOOL success = result == SQLITE_DONE;
+    if (success) {
+        [self setProgress:1.0];
+        if (progressHandler) {
+            dispatch_async(dispatch_get_main_queue(), ^{
+                progressHandler(1.0);
+            });
+        }
+    } else if (![self isCancelled]) {
+        NSLog(@"Backup to '%@' failed: %s", path, sqlite3_errstr(result));
+    }
+    sqlite3_close(destination);
+    return success;
+}
+
+
+- (void)cancel {
+    [self setCancelled:YES];
+}
+
+
+// The handler runs on the backup's own queue once the step in progress ends, without blocking the caller
+- (void)cancelWithCompletionHandler:(dispatch_block_t)completionHandler {
+    [self setCancelled:YES];
+    dispatch_group_notify(_group, _queue, completionHandler);
+}
+
+@end
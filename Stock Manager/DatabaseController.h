@@ -7,31 +7,86 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "DatabaseBackup.h"
+#import "ComponentRating.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
+typedef NS_ENUM(NSInteger, DatabaseStorageProfile) {
+    DatabaseStorageProfileDurable,          //Full sync on every commit, small page cache
+    DatabaseStorageProfileBalanced,         //WAL with normal sync, larger cache and in-memory temporaries
+    DatabaseStorageProfileReadOptimized     //Balanced plus a large cache and memory-mapped reads
+};
+
+typedef void (^DatabaseMetadataCompletionHandler)(NSDictionary * _Nullable metadata);
+typedef void (^DatabaseBenchmarkCompletionHandler)(NSDictionary<NSNumber *, NSNumber *> *timings,
+                                                   DatabaseStorageProfile recommendedProfile);
+
 @interface DatabaseController : NSObject
 
 @property (class, readonly, strong) DatabaseController *sharedController; //Singleton instance
 @property (readonly) NSArray<NSString *> *dateColumns;
+@property (readonly) NSUndoManager *undoManager; //Journal of stock movements and registrations
+@property NSTimeInterval maintenanceTimeBudget; //Longest a maintenance slice may hold the connection
+@property (nonatomic) DatabaseStorageProfile storageProfile; //Applied on open and immediately when changed
+@property (nonatomic) BOOL usesColumnarMirror; //Parametric searches filter an in-memory copy of stock
 
 - (BOOL)openDatabaseAtPath:(NSString *)path;
 - (void)closeDatabase;
 - (BOOL)isNullableColumn:(NSString *)column table:(NSString *)table;
+- (NSSet<NSString *> *)nullableColumnsOfTable:(NSString *)table;
 - (NSArray *)componentTypes;
 - (NSArray *)manufacturers;
 - (NSArray *)packageCodes;
+- (NSDictionary<NSString *, NSNumber *> *)componentTypeUsageCounts;
+- (NSDictionary<NSString *, NSNumber *> *)manufacturerUsageCounts;
+- (NSDictionary<NSString *, NSNumber *> *)packageCodeUsageCounts;
+- (NSArray<NSDictionary *> *)componentTypeSummaries;
 - (NSNumber *)stockForComponentID:(NSNumber *)componentID;
-- (NSMutableArray<NSMutableDictionary *> *)incrementalSearchResultsForPartNumber:(NSString *)partNumber;
-- (NSMutableArray<NSMutableDictionary *> *)searchResultsForComponentType:(NSString *)type;
+- (NSMutableArray<NSMutableDictionary *> *)incrementalSearchResultsForPartNumber:(NSString *)partNumber
+                                                                  sortDescriptors:(NSArray<NSSortDescriptor *> *)sortDescriptors;
+- (NSMutableArray<NSMutableDictionary *> *)searchResultsForComponentType:(NSString *)type
+                                                         sortDescriptors:(NSArray<NSSortDescriptor *> *)sortDescriptors;
+- (NSMutableArray<NSMutableDictionary *> *)searchResultsForParameters:(NSDictionary *)parameters;
+- (NSMutableArray<NSMutableDictionary *> *)searchResultsForRatingValue:(double)value kind:(ComponentRatingKind)kind;
+- (NSArray<NSDictionary *> *)nearestStockedValuesTo:(double)target
+                                               kind:(ComponentRatingKind)kind
+                                              count:(NSUInteger)count
+                                            filters:(NSDictionary *)filters;
+- (NSArray<NSDictionary *> *)combinationsForTarget:(double)target
+                                              kind:(ComponentRatingKind)kind
+                                         tolerance:(double)tolerance
+                                   includesTriples:(BOOL)includesTriples
+                                             limit:(NSUInteger)limit;
+- (NSMutableArray<NSMutableDictionary *> *)substitutesForComponentID:(NSNumber *)componentID limit:(NSUInteger)limit;
+- (NSMutableArray<NSMutableDictionary *> *)searchResultsBelowMinimumQuantity;
+- (NSUInteger)countOfComponentsBelowMinimumQuantity;
+- (NSMutableArray<NSMutableDictionary *> *)searchResultsRunningOutSoonest;
 - (NSMutableArray<NSDictionary *> *)stockReplenishmentsForComponentID:(NSNumber *)component_id;
 - (NSMutableArray<NSDictionary *> *)stockWithdrawalsForComponentID:(NSNumber *)component_id;
 - (nullable NSMutableDictionary *)recordForPartNumber:(NSString *)partNumber
                                          manufacturer:(NSString *)manufacturer;
+- (NSMutableArray<NSMutableDictionary *> *)similarRecordsForPartNumber:(NSString *)partNumber;
+- (NSArray<NSArray<NSMutableDictionary *> *> *)duplicateComponentClusters;
 - (void)stockReplenishmentWithParameters:(NSDictionary *)parameters;
 - (void)stockWithdrawalWithParameters:(NSDictionary *)parameters;
 - (void)registerComponentWithParameters:(NSDictionary *)parameters;
+- (void)setMinimumQuantity:(nullable NSNumber *)minimumQuantity forComponentID:(NSNumber *)componentID;
+- (nullable NSNumber *)setQuantity:(NSNumber *)quantity
+                    forComponentID:(NSNumber *)componentID
+            inBillOfMaterialsNamed:(NSString *)name;
+- (NSArray<NSDictionary *> *)billsOfMaterials;
+- (NSUInteger)buildableCountForBillOfMaterialsID:(NSNumber *)bomID;
+- (BOOL)kitWithdrawalWithParameters:(NSDictionary *)parameters;
+- (nullable DatabaseBackup *)backUpDatabaseToPath:(NSString *)path
+                                  progressHandler:(nullable DatabaseBackupProgressHandler)progressHandler
+                                completionHandler:(nullable DatabaseBackupCompletionHandler)completionHandler;
+- (void)scheduleBackupsToDirectory:(nullable NSString *)directory interval:(NSTimeInterval)interval;
 
++ (void)loadStartupMetadataForDatabaseAtPath:(NSString *)path
+                           completionHandler:(DatabaseMetadataCompletionHandler)completionHandler;
++ (void)benchmarkStorageProfilesForDatabaseAtPath:(NSString *)path
+                                completionHandler:(DatabaseBenchmarkCompletionHandler)completionHandler;
 + (NSDate *)dateWithClearedTimeComponentsFromDate:(NSDate *)date;
 
 @end
@@ -9,12 +9,65 @@
 #import "DatabaseController.h"
 #import "FMDB.h"
 #import "ComponentRating.h"
+#import "ConsumptionForecaster.h"
+#import "DatabaseBackup.h"
+#import "ColumnarStockMirror.h"
+#import "CombinationFinder.h"
+#import "SubstituteIndex.h"
+#import "LookupTableCache.h"
+#import "NaturalOrder.h"
+#import <sqlite3.h>
+
+#define BASELINE_SCHEMA_VERSION 3 //Schema v1.3 files predate user_version bookkeeping
+#define CONSUMPTION_RATES_SCHEMA_VERSION 9
+#define FORECAST_RESULT_LIMIT 50
+#define RATING_MATCH_TOLERANCE 1e-9 //Relative, absorbing the rounding of values typed in other notations
+#define BACKUP_RETENTION_COUNT 10 //Scheduled backups kept per database
+#define MAINTENANCE_POLL_INTERVAL 5.0 //Seconds between idle checks
+#define MAINTENANCE_IDLE_DELAY 10.0 //Seconds without writes before idle maintenance starts
+#define MAINTENANCE_SLICE_DELAY 0.1 //Seconds between slices, leaving the main queue free for events
+#define DEFAULT_MAINTENANCE_TIME_BUDGET 0.02
+#define ANALYZE_CHANGE_THRESHOLD 1000 //Rows changed before statistics are considered stale
+#define INCREMENTAL_VACUUM_PAGES 16
+#define WAL_CHECKPOINT_THRESHOLD 1000 //Frames, SQLite's own autocheckpoint default
+#define WAL_CHECKPOINT_LIMIT 10000 //Past this the checkpoint runs at commit instead of waiting for idle time
+#define BENCHMARK_SAMPLE_SIZE 50
+#define BENCHMARK_REPETITIONS 3
+#define BENCHMARK_SIGNIFICANT_SPEEDUP 0.75 //A less durable profile must cut the time by a quarter to be recommended
+
+// Canonical spelling used to catch variants such as "LM358N", "lm358n" and "LM 358-N"
+#define NORMALIZED_KEY(expression) "upper(replace(replace(replace(replace(replace(replace(" expression ", ' ', ''), '-', ''), '.', ''), '/', ''), '_', ''), ',', ''))"
+// A merged v1.4 duplicate, the row aliased "merged", kept as a line of the surviving row's comments
+#define DUPLICATE_NOTE "'Merged duplicate #' || merged.component_id || ': ' || merged.component_type || IFNULL(', package ' || merged.package_code, '')" \
+    " || IFNULL(', voltage ' || merged.voltage_rating, '') || IFNULL(', current ' || merged.current_rating, '') || IFNULL(', power ' || merged.power_rating, '')" \
+    " || IFNULL(', resistance ' || merged.resistance_rating, '') || IFNULL(', inductance ' || merged.inductance_rating, '') || IFNULL(', capacitance ' || merged.capacitance_rating, '')" \
+    " || IFNULL(', frequency ' || merged.frequency_rating, '') || IFNULL(', tolerance ' || merged.tolerance_rating, '') || IFNULL('; ' || merged.comments, '')"
+#define DUPLICATE_DIFFERS "(merged.comments IS NOT NULL OR merged.component_type IS NOT stock.component_type OR merged.package_code IS NOT stock.package_code" \
+    " OR merged.voltage_rating IS NOT stock.voltage_rating OR merged.current_rating IS NOT stock.current_rating OR merged.power_rating IS NOT stock.power_rating" \
+    " OR merged.resistance_rating IS NOT stock.resistance_rating OR merged.inductance_rating IS NOT stock.inductance_rating OR merged.capacitance_rating IS NOT stock.capacitance_rating" \
+    " OR merged.frequency_rating IS NOT stock.frequency_rating OR merged.tolerance_rating IS NOT stock.tolerance_rating)"
 
 @interface DatabaseController ()
 
 @property FMDatabase *database;
 @property NSISO8601DateFormatter *dateFormatter;
 @property (readwrite) NSArray<NSString *> *dateColumns;
+@property (readwrite) NSUndoManager *undoManager;
+@property DatabaseBackup *backup;
+@property dispatch_source_t backupTimer;
+@property dispatch_source_t maintenanceTimer;
+@property NSMutableArray<NSString *> *pendingAnalyzeTargets;
+@property int observedTotalChanges;
+@property int analyzedTotalChanges;
+@property CFAbsoluteTime lastWriteTime;
+@property BOOL maintenanceInProgress;
+@property int walFrameCount;
+@property NSMutableDictionary<NSNumber *, NSString *> *parametricQueries;
+@property ColumnarStockMirror *columnarMirror;
+@property SubstituteIndex *substituteIndex; //Built on the first substitute search
+@property LookupTableCache *componentTypeCache;
+@property LookupTableCache *manufacturerCache;
+@property LookupTableCache *packageCodeCache;
 
 @end
 
@@ -38,17 +91,24 @@
             @"date_acquired",
             @"date_spent"
         ];
+        _undoManager = [[NSUndoManager alloc] init];
+        _maintenanceTimeBudget = DEFAULT_MAINTENANCE_TIME_BUDGET;
+        _storageProfile = DatabaseStorageProfileBalanced;
+        _parametricQueries = [[NSMutableDictionary alloc] init];
     }
     return self;
 }
 
 
 - (BOOL)openDatabaseAtPath:(NSString *)path {
-    if ([_database isOpen]) {
-        [_database close];
-    }
+    [self stopMaintenance];
+    [self setColumnarMirror:nil];
+    [self setSubstituteIndex:nil];
+    [self closeConnection];
+    [_undoManager removeAllActions]; //Journal entries refer to rows of the previous database
     [self setDatabase:[FMDatabase databaseWithPath:path]];
-    if (![_database openWithFlags:SQLITE_OPEN_READWRITE]) {
+    // Full mutex lets backups step through this same connection from their own queue
+    if (![_database openWithFlags:SQLITE_OPEN_READWRITE | SQLITE_OPEN_FULLMUTEX]) {
         NSLog(@"Controller failed to open database file '%@'.", path);
         return NO;
     }
@@ -59,23 +119,477 @@
     }
     // Configure database
     [_database setDateFormat:_dateFormatter];
+    [_database setShouldCacheStatements:YES];
     [self enableCaseSensitiveLike];
+    if (![self registerNaturalOrder] || ![self registerEngineeringFunctions]) {
+        [_database close];
+        return NO;
+    }
+    [self applyStorageProfile];
+    if (![self migrateSchema]) {
+        [_database close];
+        return NO;
+    }
+    [self fillMissingPartSortKeys];
+    [self setComponentTypeCache:[[LookupTableCache alloc] initWithDatabase:_database table:@"component_types"]];
+    [self setManufacturerCache:[[LookupTableCache alloc] initWithDatabase:_database table:@"manufacturers"]];
+    [self setPackageCodeCache:[[LookupTableCache alloc] initWithDatabase:_database table:@"package_codes"]];
+    [self startMaintenance];
+    if (_usesColumnarMirror) {
+        [self loadColumnarMirror];
+    }
     return YES;
 }
 
 
 - (void)closeDatabase {
-    [_database close];
+    [self stopMaintenance];
+    [self setColumnarMirror:nil];
+    [self setSubstituteIndex:nil];
+    [self setComponentTypeCache:nil];
+    [self setManufacturerCache:nil];
+    [self setPackageCodeCache:nil];
+    [_undoManager removeAllActions];
+    [self closeConnection];
     [self setDatabase:nil];
 }
 
 
++ (NSArray<NSString *> *)schemaMigrations {
+    // Element i upgrades a schema v1.(i + 3) database to v1.(i + 4)
+    static NSArray *migrations = nil;
+    if (!migrations) {
+        migrations = @[
+            // v1.4: Part key of parts without a manufacturer, which the UNIQUE constraint let repeat. Such repeats are first merged
+            // into their oldest row, which takes over their stock and movements; a row describing the part differently or with
+            // comments of its own is noted in the comments of the row it merged into
+            @"UPDATE acquisitions SET fk_component_id = (SELECT MIN(kept.component_id) FROM stock AS kept JOIN stock AS merged ON kept.part_number = merged.part_number WHERE merged.component_id = fk_component_id AND kept.manufacturer IS NULL) "
+            "WHERE fk_component_id IN (SELECT component_id FROM stock WHERE manufacturer IS NULL);"
+            "UPDATE expenditures SET fk_component_id = (SELECT MIN(kept.component_id) FROM stock AS kept JOIN stock AS merged ON kept.part_number = merged.part_number WHERE merged.component_id = fk_component_id AND kept.manufacturer IS NULL) "
+            "WHERE fk_component_id IN (SELECT component_id FROM stock WHERE manufacturer IS NULL);"
+            "UPDATE stock SET quantity = (SELECT SUM(merged.quantity) FROM stock AS merged WHERE merged.part_number = stock.part_number AND merged.manufacturer IS NULL), "
+            "comments = COALESCE(comments || char(10) || (SELECT group_concat(" DUPLICATE_NOTE ", char(10)) FROM stock AS merged WHERE merged.part_number = stock.part_number AND merged.manufacturer IS NULL AND merged.component_id > stock.component_id AND " DUPLICATE_DIFFERS "), "
+            "(SELECT group_concat(" DUPLICATE_NOTE ", char(10)) FROM stock AS merged WHERE merged.part_number = stock.part_number AND merged.manufacturer IS NULL AND merged.component_id > stock.component_id AND " DUPLICATE_DIFFERS "), comments) "
+            "WHERE manufacturer IS NULL AND component_id = (SELECT MIN(kept.component_id) FROM stock AS kept WHERE kept.part_number = stock.part_number AND kept.manufacturer IS NULL);"
+            "DELETE FROM stock WHERE manufacturer IS NULL AND component_id > (SELECT MIN(kept.component_id) FROM stock AS kept WHERE kept.part_number = stock.part_number AND kept.manufacturer IS NULL);"
+            "CREATE UNIQUE INDEX stock_part_key ON stock(part_number) WHERE manufacturer IS NULL;",
+            // v1.5: Normalized part number and manufacturer keys, kept current by triggers
+            @"ALTER TABLE stock ADD COLUMN part_key TEXT;"
+            "ALTER TABLE stock ADD COLUMN manufacturer_key TEXT NOT NULL DEFAULT '';"
+            "UPDATE stock SET part_key = " NORMALIZED_KEY("part_number") ", manufacturer_key = " NORMALIZED_KEY("IFNULL(manufacturer, '')") ";"
+            "CREATE INDEX stock_normalized_key ON stock(part_key, manufacturer_key);"
+            "CREATE TRIGGER stock_normalized_key_insert AFTER INSERT ON stock BEGIN "
+            "UPDATE stock SET part_key = " NORMALIZED_KEY("NEW.part_number") ", manufacturer_key = " NORMALIZED_KEY("IFNULL(NEW.manufacturer, '')") " WHERE component_id = NEW.component_id; "
+            "END;"
+            "CREATE TRIGGER stock_normalized_key_update AFTER UPDATE OF part_number, manufacturer ON stock BEGIN "
+            "UPDATE stock SET part_key = " NORMALIZED_KEY("NEW.part_number") ", manufacturer_key = " NORMALIZED_KEY("IFNULL(NEW.manufacturer, '')") " WHERE component_id = NEW.component_id; "
+            "END;",
+            // v1.6: Reference-counted lookup tables of distinct types, manufacturers and package codes
+            @"CREATE TABLE component_types (id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE, ref_count INTEGER NOT NULL DEFAULT 0);"
+            "CREATE TABLE manufacturers (id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE, ref_count INTEGER NOT NULL DEFAULT 0);"
+            "CREATE TABLE package_codes (id INTEGER PRIMARY KEY, name TEXT NOT NULL UNIQUE, ref_count INTEGER NOT NULL DEFAULT 0);"
+            "INSERT INTO component_types(name, ref_count) SELECT component_type, COUNT(*) FROM stock GROUP BY component_type;"
+            "INSERT INTO manufacturers(name, ref_count) SELECT manufacturer, COUNT(*) FROM stock WHERE manufacturer IS NOT NULL GROUP BY manufacturer;"
+            "INSERT INTO package_codes(name, ref_count) SELECT package_code, COUNT(*) FROM stock WHERE package_code IS NOT NULL GROUP BY package_code;"
+            "CREATE TRIGGER stock_lookup_insert AFTER INSERT ON stock BEGIN "
+            "INSERT INTO component_types(name, ref_count) VALUES (NEW.component_type, 1) ON CONFLICT(name) DO UPDATE SET ref_count = ref_count + 1; "
+            "INSERT INTO manufacturers(name, ref_count) SELECT NEW.manufacturer, 1 WHERE NEW.manufacturer IS NOT NULL ON CONFLICT(name) DO UPDATE SET ref_count = ref_count + 1; "
+            "INSERT INTO package_codes(name, ref_count) SELECT NEW.package_code, 1 WHERE NEW.package_code IS NOT NULL ON CONFLICT(name) DO UPDATE SET ref_count = ref_count + 1; "
+            "END;"
+            "CREATE TRIGGER stock_lookup_delete AFTER DELETE ON stock BEGIN "
+            "UPDATE component_types SET ref_count = ref_count - 1 WHERE name = OLD.component_type; "
+            "UPDATE manufacturers SET ref_count = ref_count - 1 WHERE name = OLD.manufacturer; "
+            "UPDATE package_codes SET ref_count = ref_count - 1 WHERE name = OLD.package_code; "
+            "DELETE FROM component_types WHERE name = OLD.component_type AND ref_count <= 0; "
+            "DELETE FROM manufacturers WHERE name = OLD.manufacturer AND ref_count <= 0; "
+            "DELETE FROM package_codes WHERE name = OLD.package_code AND ref_count <= 0; "
+            "END;"
+            "CREATE TRIGGER stock_lookup_update_type AFTER UPDATE OF component_type ON stock WHEN OLD.component_type IS NOT NEW.component_type BEGIN "
+            "UPDATE component_types SET ref_count = ref_count - 1 WHERE name = OLD.component_type; "
+            "DELETE FROM component_types WHERE name = OLD.component_type AND ref_count <= 0; "
+            "INSERT INTO component_types(name, ref_count) VALUES (NEW.component_type, 1) ON CONFLICT(name) DO UPDATE SET ref_count = ref_count + 1; "
+            "END;"
+            "CREATE TRIGGER stock_lookup_update_manufacturer AFTER UPDATE OF manufacturer ON stock WHEN OLD.manufacturer IS NOT NEW.manufacturer BEGIN "
+            "UPDATE manufacturers SET ref_count = ref_count - 1 WHERE name = OLD.manufacturer; "
+            "DELETE FROM manufacturers WHERE name = OLD.manufacturer AND ref_count <= 0; "
+            "INSERT INTO manufacturers(name, ref_count) SELECT NEW.manufacturer, 1 WHERE NEW.manufacturer IS NOT NULL ON CONFLICT(name) DO UPDATE SET ref_count = ref_count + 1; "
+            "END;"
+            "CREATE TRIGGER stock_lookup_update_package AFTER UPDATE OF package_code ON stock WHEN OLD.package_code IS NOT NEW.package_code BEGIN "
+            "UPDATE package_codes SET ref_count = ref_count - 1 WHERE name = OLD.package_code; "
+            "DELETE FROM package_codes WHERE name = OLD.package_code AND ref_count <= 0; "
+            "INSERT INTO package_codes(name, ref_count) SELECT NEW.package_code, 1 WHERE NEW.package_code IS NOT NULL ON CONFLICT(name) DO UPDATE SET ref_count = ref_count + 1; "
+            "END;",
+            // v1.7: Units in stock per component type, kept alongside its component count
+            @"ALTER TABLE component_types ADD COLUMN total_quantity INTEGER NOT NULL DEFAULT 0;"
+            "UPDATE component_types SET total_quantity = (SELECT SUM(quantity) FROM stock WHERE component_type = component_types.name);"
+            "DROP TRIGGER stock_lookup_insert;"
+            "DROP TRIGGER stock_lookup_delete;"
+            "DROP TRIGGER stock_lookup_update_type;"
+            "CREATE TRIGGER stock_lookup_insert AFTER INSERT ON stock BEGIN "
+            "INSERT INTO component_types(name, ref_count, total_quantity) VALUES (NEW.component_type, 1, NEW.quantity) ON CONFLICT(name) DO UPDATE SET ref_count = ref_count + 1, total_quantity = total_quantity + excluded.total_quantity; "
+            "INSERT INTO manufacturers(name, ref_count) SELECT NEW.manufacturer, 1 WHERE NEW.manufacturer IS NOT NULL ON CONFLICT(name) DO UPDATE SET ref_count = ref_count + 1; "
+            "INSERT INTO package_codes(name, ref_count) SELECT NEW.package_code, 1 WHERE NEW.package_code IS NOT NULL ON CONFLICT(name) DO UPDATE SET ref_count = ref_count + 1; "
+            "END;"
+            "CREATE TRIGGER stock_lookup_delete AFTER DELETE ON stock BEGIN "
+            "UPDATE component_types SET ref_count = ref_count - 1, total_quantity = total_quantity - OLD.quantity WHERE name = OLD.component_type; "
+            "UPDATE manufacturers SET ref_count = ref_count - 1 WHERE name = OLD.manufacturer; "
+            "UPDATE package_codes SET ref_count = ref_count - 1 WHERE name = OLD.package_code; "
+            "DELETE FROM component_types WHERE name = OLD.component_type AND ref_count <= 0; "
+            "DELETE FROM manufacturers WHERE name = OLD.manufacturer AND ref_count <= 0; "
+            "DELETE FROM package_codes WHERE name = OLD.package_code AND ref_count <= 0; "
+            "END;"
+            "CREATE TRIGGER stock_lookup_update_type AFTER UPDATE OF component_type ON stock WHEN OLD.component_type IS NOT NEW.component_type BEGIN "
+            "UPDATE component_types SET ref_count = ref_count - 1, total_quantity = total_quantity - OLD.quantity WHERE name = OLD.component_type; "
+            "DELETE FROM component_types WHERE name = OLD.component_type AND ref_count <= 0; "
+            "INSERT INTO component_types(name, ref_count, total_quantity) VALUES (NEW.component_type, 1, NEW.quantity) ON CONFLICT(name) DO UPDATE SET ref_count = ref_count + 1, total_quantity = total_quantity + excluded.total_quantity; "
+            "END;"
+            "CREATE TRIGGER stock_lookup_update_quantity AFTER UPDATE OF quantity ON stock WHEN OLD.quantity IS NOT NEW.quantity AND OLD.component_type IS NEW.component_type BEGIN "
+            "UPDATE component_types SET total_quantity = total_quantity + NEW.quantity - OLD.quantity WHERE name = NEW.component_type; "
+            "END;",
+            // v1.8: Reorder thresholds, with an index holding only the components below theirs
+            @"ALTER TABLE stock ADD COLUMN min_quantity INTEGER CHECK(min_quantity >= 0);"
+            "CREATE INDEX stock_below_minimum ON stock(part_number) WHERE quantity < min_quantity;",
+            // v1.9: Decayed consumption sums per component (filled in by ConsumptionForecaster)
+            @"CREATE TABLE consumption_rates (fk_component_id INTEGER PRIMARY KEY, usage_30 REAL NOT NULL DEFAULT 0, usage_90 REAL NOT NULL DEFAULT 0, usage_365 REAL NOT NULL DEFAULT 0, reference_time REAL NOT NULL, FOREIGN KEY(fk_component_id) REFERENCES stock(component_id) ON UPDATE CASCADE ON DELETE CASCADE);",
+            // v1.10: Bills of materials, one line per component with the quantity a build needs
+            @"CREATE TABLE boms (id INTEGER PRIMARY KEY AUTOINCREMENT, name TEXT NOT NULL UNIQUE, comments TEXT);"
+            "CREATE TABLE bom_lines (fk_bom_id INTEGER NOT NULL, fk_component_id INTEGER NOT NULL, quantity INTEGER NOT NULL CHECK(quantity > 0), PRIMARY KEY(fk_bom_id, fk_component_id), FOREIGN KEY(fk_bom_id) REFERENCES boms(id) ON UPDATE CASCADE ON DELETE CASCADE, FOREIGN KEY(fk_component_id) REFERENCES stock(component_id) ON UPDATE CASCADE ON DELETE CASCADE) WITHOUT ROWID;",
+            // v1.11: Composite indexes for parametric search by type, value range and package
+            @"CREATE INDEX stock_type_resistance ON stock(component_type, resistance_rating, package_code);"
+            "CREATE INDEX stock_type_capacitance ON stock(component_type, capacitance_rating, package_code);"
+            "CREATE INDEX stock_type_inductance ON stock(component_type, inductance_rating, package_code);"
+            "CREATE INDEX stock_type_voltage ON stock(component_type, voltage_rating, package_code);",
+            // v1.12: Partial indexes of in-stock values for nearest value lookups
+            @"CREATE INDEX stock_stocked_resistance ON stock(resistance_rating, package_code, tolerance_rating) WHERE quantity > 0;"
+            "CREATE INDEX stock_stocked_capacitance ON stock(capacitance_rating, package_code, tolerance_rating) WHERE quantity > 0;"
+            "CREATE INDEX stock_stocked_inductance ON stock(inductance_rating, package_code, tolerance_rating) WHERE quantity > 0;",
+            // v1.13: Types, manufacturers and package codes stored as lookup table ids, with a view of the names for older readers.
+            // Stock is rebuilt keeping its AUTOINCREMENT sequence, and lookup rows are no longer deleted, so an id always names the same value
+            @"CREATE TABLE stock_encoded (component_id INTEGER PRIMARY KEY AUTOINCREMENT, part_number TEXT NOT NULL, manufacturer_id INTEGER REFERENCES manufacturers(id), quantity INTEGER NOT NULL DEFAULT 0 CHECK(quantity >= 0), component_type_id INTEGER NOT NULL REFERENCES component_types(id), voltage_rating REAL, current_rating REAL, power_rating REAL, resistance_rating REAL, inductance_rating REAL, capacitance_rating REAL, frequency_rating REAL, tolerance_rating REAL, package_code_id INTEGER REFERENCES package_codes(id), comments TEXT, part_key TEXT, manufacturer_key TEXT NOT NULL DEFAULT '', min_quantity INTEGER CHECK(min_quantity >= 0), UNIQUE(part_number, manufacturer_id));"
+            "INSERT INTO stock_encoded SELECT component_id, part_number, (SELECT id FROM manufacturers WHERE name = manufacturer), quantity, (SELECT id FROM component_types WHERE name = component_type), voltage_rating, current_rating, power_rating, resistance_rating, inductance_rating, capacitance_rating, frequency_rating, tolerance_rating, (SELECT id FROM package_codes WHERE name = package_code), comments, part_key, manufacturer_key, min_quantity FROM stock;"
+            "DELETE FROM sqlite_sequence WHERE name = 'stock_encoded';"
+            "INSERT INTO sqlite_sequence(name, seq) SELECT 'stock_encoded', seq FROM sqlite_sequence WHERE name = 'stock';"
+            "DROP TABLE stock;"
+            "ALTER TABLE stock_encoded RENAME TO stock;"
+            "CREATE UNIQUE INDEX stock_part_key ON stock(part_number, IFNULL(manufacturer_id, 0));"
+            "CREATE INDEX stock_normalized_key ON stock(part_key, manufacturer_key);"
+            "CREATE INDEX stock_below_minimum ON stock(part_number) WHERE quantity < min_quantity;"
+            "CREATE INDEX stock_type_resistance ON stock(component_type_id, resistance_rating, package_code_id);"
+            "CREATE INDEX stock_type_capacitance ON stock(component_type_id, capacitance_rating, package_code_id);"
+            "CREATE INDEX stock_type_inductance ON stock(component_type_id, inductance_rating, package_code_id);"
+            "CREATE INDEX stock_type_voltage ON stock(component_type_id, voltage_rating, package_code_id);"
+            "CREATE INDEX stock_stocked_resistance ON stock(resistance_rating, package_code_id, tolerance_rating) WHERE quantity > 0;"
+            "CREATE INDEX stock_stocked_capacitance ON stock(capacitance_rating, package_code_id, tolerance_rating) WHERE quantity > 0;"
+            "CREATE INDEX stock_stocked_inductance ON stock(inductance_rating, package_code_id, tolerance_rating) WHERE quantity > 0;"
+            "CREATE TRIGGER stock_normalized_key_insert AFTER INSERT ON stock BEGIN "
+            "UPDATE stock SET part_key = " NORMALIZED_KEY("NEW.part_number") ", manufacturer_key = " NORMALIZED_KEY("IFNULL((SELECT name FROM manufacturers WHERE id = NEW.manufacturer_id), '')") " WHERE component_id = NEW.component_id; "
+            "END;"
+            "CREATE TRIGGER stock_normalized_key_update AFTER UPDATE OF part_number, manufacturer_id ON stock BEGIN "
+            "UPDATE stock SET part_key = " NORMALIZED_KEY("NEW.part_number") ", manufacturer_key = " NORMALIZED_KEY("IFNULL((SELECT name FROM manufacturers WHERE id = NEW.manufacturer_id), '')") " WHERE component_id = NEW.component_id; "
+            "END;"
+            "CREATE TRIGGER stock_lookup_insert AFTER INSERT ON stock BEGIN "
+            "UPDATE component_types SET ref_count = ref_count + 1, total_quantity = total_quantity + NEW.quantity WHERE id = NEW.component_type_id; "
+            "UPDATE manufacturers SET ref_count = ref_count + 1 WHERE id = NEW.manufacturer_id; "
+            "UPDATE package_codes SET ref_count = ref_count + 1 WHERE id = NEW.package_code_id; "
+            "END;"
+            "CREATE TRIGGER stock_lookup_delete AFTER DELETE ON stock BEGIN "
+            "UPDATE component_types SET ref_count = ref_count - 1, total_quantity = total_quantity - OLD.quantity WHERE id = OLD.component_type_id; "
+            "UPDATE manufacturers SET ref_count = ref_count - 1 WHERE id = OLD.manufacturer_id; "
+            "UPDATE package_codes SET ref_count = ref_count - 1 WHERE id = OLD.package_code_id; "
+            "END;"
+            "CREATE TRIGGER stock_lookup_update_type AFTER UPDATE OF component_type_id ON stock WHEN OLD.component_type_id IS NOT NEW.component_type_id BEGIN "
+            "UPDATE component_types SET ref_count = ref_count - 1, total_quantity = total_quantity - OLD.quantity WHERE id = OLD.component_type_id; "
+            "UPDATE component_types SET ref_count = ref_count + 1, total_quantity = total_quantity + NEW.quantity WHERE id = NEW.component_type_id; "
+            "END;"
+            "CREATE TRIGGER stock_lookup_update_manufacturer AFTER UPDATE OF manufacturer_id ON stock WHEN OLD.manufacturer_id IS NOT NEW.manufacturer_id BEGIN "
+            "UPDATE manufacturers SET ref_count = ref_count - 1 WHERE id = OLD.manufacturer_id; "
+            "UPDATE manufacturers SET ref_count = ref_count + 1 WHERE id = NEW.manufacturer_id; "
+            "END;"
+            "CREATE TRIGGER stock_lookup_update_package AFTER UPDATE OF package_code_id ON stock WHEN OLD.package_code_id IS NOT NEW.package_code_id BEGIN "
+            "UPDATE package_codes SET ref_count = ref_count - 1 WHERE id = OLD.package_code_id; "
+            "UPDATE package_codes SET ref_count = ref_count + 1 WHERE id = NEW.package_code_id; "
+            "END;"
+            "CREATE TRIGGER stock_lookup_update_quantity AFTER UPDATE OF quantity ON stock WHEN OLD.quantity IS NOT NEW.quantity AND OLD.component_type_id IS NEW.component_type_id BEGIN "
+            "UPDATE component_types SET total_quantity = total_quantity + NEW.quantity - OLD.quantity WHERE id = NEW.component_type_id; "
+            "END;"
+            "CREATE VIEW stock_named AS SELECT stock.component_id, stock.part_number, manufacturers.name AS manufacturer, stock.quantity, component_types.name AS component_type, stock.voltage_rating, stock.current_rating, stock.power_rating, stock.resistance_rating, stock.inductance_rating, stock.capacitance_rating, stock.frequency_rating, stock.tolerance_rating, package_codes.name AS package_code, stock.comments, stock.part_key, stock.manufacturer_key, stock.min_quantity "
+            "FROM stock JOIN component_types ON component_types.id = stock.component_type_id LEFT JOIN manufacturers ON manufacturers.id = stock.manufacturer_id LEFT JOIN package_codes ON package_codes.id = stock.package_code_id;",
+            // v1.14: Natural order sort keys of part numbers, written by the application along with the part number
+            @"ALTER TABLE stock ADD COLUMN part_sort_key TEXT;"
+            "UPDATE stock SET part_sort_key = natural_sort_key(part_number);"
+            "CREATE INDEX stock_part_natural ON stock(part_sort_key);"
+        ];
+    }
+    return migrations;
+}
+
+
+- (BOOL)migrateSchema {
+    NSArray<NSString *> *migrations = [DatabaseController schemaMigrations];
+    uint32_t version = MAX([_database userVersion], BASELINE_SCHEMA_VERSION);
+    while (version - BASELINE_SCHEMA_VERSION < [migrations count]) {
+        [_database beginExclusiveTransaction];
+        if (![_database executeStatements:migrations[version - BASELINE_SCHEMA_VERSION]]) {
+            NSLog(@"Controller failed to migrate database to schema v1.%u: %@", version + 1, [_database lastErrorMessage]);
+            [_database rollback];
+            return NO;
+        }
+        version++;
+        // Decayed sums need exp(), which SQLite lacks, so this backfill runs here
+        if (version == CONSUMPTION_RATES_SCHEMA_VERSION && ![ConsumptionForecaster rebuildConsumptionRatesInDatabase:_database]) {
+            NSLog(@"Controller failed to compute consumption rates: %@", [_database lastErrorMessage]);
+            [_database rollback];
+            return NO;
+        }
+        [_database setUserVersion:version];
+        [_database commit];
+    }
+    return YES;
+}
+
+
+/*
+ Only registration writes the key, so rows inserted by anything else, stockd or a tool editing the
+ file, come without one. They get theirs on opening and before each prefix search; finding none
+ is a single lookup on the natural order index, so the search keeps its ordered range scan.
+ */
+- (void)fillMissingPartSortKeys {
+    if (![_database boolForQuery:@"SELECT EXISTS (SELECT 1 FROM stock WHERE part_sort_key IS NULL)"]) {
+        return;
+    }
+    if (![_database executeUpdate:@"UPDATE stock SET part_sort_key = natural_sort_key(part_number) WHERE part_sort_key IS NULL"]) {
+        NSLog(@"Controller failed to fill part sort keys: %@", [_database lastErrorMessage]);
+    }
+}
+
+
 - (void)enableCaseSensitiveLike {
     FMResultSet *resultSet = [_database executeQuery:@"PRAGMA case_sensitive_like=ON"];
     [resultSet close];
 }
 
 
+static void naturalSortKeyFunction(sqlite3_context *context, int argumentCount, sqlite3_value **arguments) {
+    if (sqlite3_value_type(arguments[0]) == SQLITE_NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+    const char *text = (const char *)sqlite3_value_text(arguments[0]);
+    size_t length = (size_t)sqlite3_value_bytes(arguments[0]);
+    char *key = sqlite3_malloc64(2 * length + 1);
+    if (!key) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+    size_t keyLength = NaturalOrderSortKey(text, length, key);
+    sqlite3_result_text64(context, key, keyLength, sqlite3_free, SQLITE_UTF8);
+}
+
+
+// natural_sort_key(), which fills the part_sort_key column on migration and on opening
+- (BOOL)registerNaturalOrder {
+    int result = sqlite3_create_function_v2([_database sqliteHandle], "natural_sort_key", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+                                            NULL, naturalSortKeyFunction, NULL, NULL, NULL);
+    if (result != SQLITE_OK) {
+        NSLog(@"Controller failed to register natural order: %s", sqlite3_errstr(result));
+        return NO;
+    }
+    return YES;
+}
+
+
+// eng_parse('4k7'): the value of engineering notation as ratings are typed, numbers as they are, anything else NULL
+static void engParseFunction(sqlite3_context *context, int argumentCount, sqlite3_value **arguments) {
+    int type = sqlite3_value_type(arguments[0]);
+    if (type == SQLITE_INTEGER || type == SQLITE_FLOAT) {
+        sqlite3_result_double(context, sqlite3_value_double(arguments[0]));
+        return;
+    }
+    ComponentRatingParseResult rating;
+    if (type != SQLITE_TEXT
+        || !ComponentRatingParse((const char *)sqlite3_value_text(arguments[0]), (size_t)sqlite3_value_bytes(arguments[0]), &rating)) {
+        sqlite3_result_null(context);
+        return;
+    }
+    sqlite3_result_double(context, rating.value);
+}
+
+
+// eng_format(value, 'Ω'): the value with a metric prefix and the unit, as "4.7 kΩ"
+static void engFormatFunction(sqlite3_context *context, int argumentCount, sqlite3_value **arguments) {
+    if (sqlite3_value_type(arguments[0]) == SQLITE_NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+    double value = sqlite3_value_double(arguments[0]);
+    const char *unitSymbol = (const char *)sqlite3_value_text(arguments[1]);
+    if (!unitSymbol) {
+        unitSymbol = "";
+    }
+    char text[64];
+    int length = ComponentRatingFormat(value, unitSymbol, text, sizeof(text));
+    if (length >= 0 && (size_t)length < sizeof(text)) {
+        sqlite3_result_text(context, text, length, SQLITE_TRANSIENT);
+        return;
+    }
+    if (length < 0) {
+        sqlite3_result_error(context, "eng_format() failed to format the value", -1);
+        return;
+    }
+    // Only a long unit gets here
+    char *longText = sqlite3_malloc(length + 1);
+    if (!longText) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+    ComponentRatingFormat(value, unitSymbol, longText, (size_t)length + 1);
+    sqlite3_result_text(context, longText, length, sqlite3_free);
+}
+
+
+// within_tol(value, target, pct): 1 if the value is within pct percent of the target, 0 if not
+static void withinToleranceFunction(sqlite3_context *context, int argumentCount, sqlite3_value **arguments) {
+    for (int i = 0; i < argumentCount; i++) {
+        if (sqlite3_value_type(arguments[i]) == SQLITE_NULL) {
+            sqlite3_result_null(context);
+            return;
+        }
+    }
+    double value = sqlite3_value_double(arguments[0]);
+    double target = sqlite3_value_double(arguments[1]);
+    double fraction = sqlite3_value_double(arguments[2]) / 100.0;
+    sqlite3_result_int(context, fabs(value - target) <= fabs(target) * (fraction + RATING_MATCH_TOLERANCE));
+}
+
+
+// e_series_index(value, 24): position of the value within its decade of that E series, or NULL if it isn't in it
+static void eSeriesIndexFunction(sqlite3_context *context, int argumentCount, sqlite3_value **arguments) {
+    if (sqlite3_value_type(arguments[0]) == SQLITE_NULL || sqlite3_value_type(arguments[1]) == SQLITE_NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+    NSInteger index = ComponentRatingESeriesIndex(sqlite3_value_double(arguments[0]), (NSInteger)sqlite3_value_int64(arguments[1]));
+    if (index < 0) {
+        sqlite3_result_null(context);
+        return;
+    }
+    sqlite3_result_int64(context, index);
+}
+
+
+static const struct {
+    const char *name;
+    int argumentCount;
+    void (*function)(sqlite3_context *, int, sqlite3_value **);
+} engineeringFunctions[] = {
+    { "eng_parse", 1, engParseFunction },
+    { "eng_format", 2, engFormatFunction },
+    { "within_tol", 3, withinToleranceFunction },
+    { "e_series_index", 2, eSeriesIndexFunction }
+};
+
+
+// Unit-aware functions for reports and ad-hoc queries. Being deterministic, they may be used in indexes and are evaluated once per row
+- (BOOL)registerEngineeringFunctions {
+    sqlite3 *handle = [_database sqliteHandle];
+    for (size_t i = 0; i < sizeof(engineeringFunctions) / sizeof(engineeringFunctions[0]); i++) {
+        int result = sqlite3_create_function_v2(handle, engineeringFunctions[i].name, engineeringFunctions[i].argumentCount,
+                                                SQLITE_UTF8 | SQLITE_DETERMINISTIC, NULL, engineeringFunctions[i].function, NULL, NULL, NULL);
+        if (result != SQLITE_OK) {
+            NSLog(@"Controller failed to register SQL function %s(): %s", engineeringFunctions[i].name, sqlite3_errstr(result));
+            return NO;
+        }
+    }
+    return YES;
+}
+
+
++ (NSString *)cachePragmasForStorageProfile:(DatabaseStorageProfile)profile {
+    // Negative cache sizes are in KiB; mmap_size is capped by the SQLite build
+    switch (profile) {
+        case DatabaseStorageProfileDurable:
+            return @"PRAGMA cache_size = -2000; PRAGMA mmap_size = 0; PRAGMA temp_store = DEFAULT;";
+        case DatabaseStorageProfileBalanced:
+            return @"PRAGMA cache_size = -16384; PRAGMA mmap_size = 0; PRAGMA temp_store = MEMORY;";
+        case DatabaseStorageProfileReadOptimized:
+            return @"PRAGMA cache_size = -65536; PRAGMA mmap_size = 268435456; PRAGMA temp_store = MEMORY;";
+    }
+}
+
+
++ (NSString *)durabilityPragmasForStorageProfile:(DatabaseStorageProfile)profile {
+    // Normal sync is only crash-safe with a write-ahead log, so the faster profiles switch to one
+    switch (profile) {
+        case DatabaseStorageProfileDurable:
+            return @"PRAGMA synchronous = FULL;";
+        case DatabaseStorageProfileBalanced:
+        case DatabaseStorageProfileReadOptimized:
+            return @"PRAGMA journal_mode = WAL; PRAGMA synchronous = NORMAL;";
+    }
+}
+
+
+- (void)applyStorageProfile {
+    NSString *pragmas = [[DatabaseController durabilityPragmasForStorageProfile:_storageProfile]
+                         stringByAppendingString:[DatabaseController cachePragmasForStorageProfile:_storageProfile]];
+    if (![_database executeStatements:pragmas]) {
+        NSLog(@"Controller failed to apply storage profile %ld: %@", (long)_storageProfile, [_database lastErrorMessage]);
+    }
+}
+
+
+- (void)setStorageProfile:(DatabaseStorageProfile)storageProfile {
+    _storageProfile = storageProfile;
+    if ([_database isOpen]) {
+        [self applyStorageProfile];
+    }
+}
+
+
+- (void)setUsesColumnarMirror:(BOOL)usesColumnarMirror {
+    _usesColumnarMirror = usesColumnarMirror;
+    if (!usesColumnarMirror) {
+        [self setColumnarMirror:nil];
+    } else if ([_database isOpen] && !_columnarMirror) {
+        [self loadColumnarMirror];
+    }
+}
+
+
+/*
+ The mirror is read through a read-only connection of its own on a background queue, then
+ installed on the main queue, where the notifications it follows are posted; parametric searches
+ run in SQL meanwhile. A load outlived by its database is dropped, and one that missed changes
+ made through this connection in the meantime starts over.
+ */
+- (void)loadColumnarMirror {
+    FMDatabase *database = _database;
+    NSString *path = [database databasePath];
+    int changeCount = sqlite3_total_changes([database sqliteHandle]);
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        ColumnarStockMirror *columnarMirror = nil;
+        FMDatabase *rowSource = [FMDatabase databaseWithPath:path];
+        if ([rowSource openWithFlags:SQLITE_OPEN_READONLY]) {
+            columnarMirror = [[ColumnarStockMirror alloc] initWithDatabase:database rowsFromDatabase:rowSource];
+            [rowSource close];
+        } else {
+            NSLog(@"Controller failed to open database file '%@' to load the columnar mirror.", path);
+        }
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (!columnarMirror || database != self->_database || ![database isOpen] || !self->_usesColumnarMirror || self->_columnarMirror) {
+                return;
+            }
+            if (sqlite3_total_changes([database sqliteHandle]) != changeCount) {
+                [self loadColumnarMirror];
+                return;
+            }
+            [columnarMirror followChangesPostedBy:self];
+            [self setColumnarMirror:columnarMirror];
+        });
+    });
+}
+
+
 - (BOOL)isNullableColumn:(NSString *)column table:(NSString *)table {
     BOOL isNullable = NO;
     FMResultSet *resultSet = [_database getTableSchema:table];
@@ -91,33 +605,89 @@
 }
 
 
-- (NSArray *)groupsFromColumn:(NSString *)columnName table:(NSString *)tableName {
-    NSMutableArray<NSString *> *groups = [[NSMutableArray alloc] init];
-    NSString *query = [NSString stringWithFormat:@"SELECT %@ FROM %@ GROUP BY %@", columnName, tableName, columnName];
-    FMResultSet *resultSet = [_database executeQuery:query];
+- (NSSet<NSString *> *)nullableColumnsOfTable:(NSString *)table {
+    // One schema read for the whole table instead of one per column
+    NSMutableSet<NSString *> *columns = [[NSMutableSet alloc] init];
+    FMResultSet *resultSet = [_database getTableSchema:table];
     while ([resultSet next]) {
-        NSString *groupName = [resultSet stringForColumnIndex:0];
-        if (groupName) {
-            [groups addObject:groupName];
+        if (![resultSet boolForColumn:@"notnull"]) {
+            [columns addObject:[resultSet stringForColumn:@"name"]];
         }
     }
     [resultSet close];
-    return [groups copy];
+    return [columns copy];
+}
+
+
+- (NSArray *)namesFromLookupTable:(NSString *)tableName {
+    // Lookup tables are maintained by triggers on stock, so this reads O(distinct values) rows
+    NSMutableArray<NSString *> *names = [[NSMutableArray alloc] init];
+    NSString *query = [NSString stringWithFormat:@"SELECT name FROM %@ WHERE ref_count > 0 ORDER BY name", tableName];
+    FMResultSet *resultSet = [_database executeQuery:query];
+    while ([resultSet next]) {
+        [names addObject:[resultSet stringForColumnIndex:0]];
+    }
+    [resultSet close];
+    return [names copy];
 }
 
 
 - (NSArray *)componentTypes {
-    return [self groupsFromColumn:@"component_type" table:@"stock"];
+    return [self namesFromLookupTable:@"component_types"];
 }
 
 
 - (NSArray *)manufacturers {
-    return [self groupsFromColumn:@"manufacturer" table:@"stock"];
+    return [self namesFromLookupTable:@"manufacturers"];
 }
 
 
 - (NSArray *)packageCodes {
-    return [self groupsFromColumn:@"package_code" table:@"stock"];
+    return [self namesFromLookupTable:@"package_codes"];
+}
+
+
+- (NSDictionary<NSString *, NSNumber *> *)usageCountsFromLookupTable:(NSString *)tableName {
+    NSMutableDictionary<NSString *, NSNumber *> *usageCounts = [[NSMutableDictionary alloc] init];
+    NSString *query = [NSString stringWithFormat:@"SELECT name, ref_count FROM %@ WHERE ref_count > 0", tableName];
+    FMResultSet *resultSet = [_database executeQuery:query];
+    while ([resultSet next]) {
+        [usageCounts setObject:[NSNumber numberWithLongLong:[resultSet longLongIntForColumnIndex:1]]
+                        forKey:[resultSet stringForColumnIndex:0]];
+    }
+    [resultSet close];
+    return [usageCounts copy];
+}
+
+
+- (NSDictionary<NSString *, NSNumber *> *)componentTypeUsageCounts {
+    return [self usageCountsFromLookupTable:@"component_types"];
+}
+
+
+- (NSDictionary<NSString *, NSNumber *> *)manufacturerUsageCounts {
+    return [self usageCountsFromLookupTable:@"manufacturers"];
+}
+
+
+- (NSDictionary<NSString *, NSNumber *> *)packageCodeUsageCounts {
+    return [self usageCountsFromLookupTable:@"package_codes"];
+}
+
+
+- (NSArray<NSDictionary *> *)componentTypeSummaries {
+    // Counts and totals are maintained by triggers on stock, so this reads O(types) rows
+    NSMutableArray<NSDictionary *> *summaries = [[NSMutableArray alloc] init];
+    FMResultSet *resultSet = [_database executeQuery:@"SELECT name, ref_count, total_quantity FROM component_types WHERE ref_count > 0 ORDER BY name"];
+    while ([resultSet next]) {
+        [summaries addObject:@{
+            @"component_type" : [resultSet stringForColumnIndex:0],
+            @"component_count" : [NSNumber numberWithLongLong:[resultSet longLongIntForColumnIndex:1]],
+            @"total_quantity" : [NSNumber numberWithLongLong:[resultSet longLongIntForColumnIndex:2]]
+        }];
+    }
+    [resultSet close];
+    return [summaries copy];
 }
 
 
@@ -133,21 +703,45 @@
 }
 
 
+- (nullable NSNumber *)minimumQuantityForComponentID:(NSNumber *)componentID {
+    NSNumber *minimumQuantity = nil;
+    FMResultSet *resultSet = [_database executeQuery:@"SELECT min_quantity FROM stock WHERE component_id = ?", componentID];
+    if ([resultSet next] && ![resultSet columnIndexIsNull:0]) {
+        minimumQuantity = [NSNumber numberWithInteger:[resultSet longForColumnIndex:0]];
+    }
+    [resultSet close];
+    return minimumQuantity;
+}
+
+
 - (NSMutableDictionary *)componentFromResultSet:(FMResultSet *)resultSet {
     NSMutableDictionary *component = [[NSMutableDictionary alloc] init];
     [component setObject:[NSNumber numberWithInteger:[resultSet longForColumn:@"component_id"]] forKey:@"component_id"];
     [component setObject:[NSNumber numberWithInteger:[resultSet longForColumn:@"quantity"]] forKey:@"quantity"];
     [component setObject:[resultSet stringForColumn:@"part_number"] forKey:@"part_number"];
-    [component setObject:[resultSet stringForColumn:@"component_type"] forKey:@"component_type"];
-    if (![resultSet columnIsNull:@"manufacturer"]) {
-        [component setObject:[resultSet stringForColumn:@"manufacturer"] forKey:@"manufacturer"];
+    // Names are shared by every row decoded with them instead of copied from each
+    NSString *componentType = [_componentTypeCache nameForID:[resultSet longLongIntForColumn:@"component_type_id"]];
+    if (componentType) {
+        [component setObject:componentType forKey:@"component_type"];
     }
-    if (![resultSet columnIsNull:@"package_code"]) {
-        [component setObject:[resultSet stringForColumn:@"package_code"] forKey:@"package_code"];
+    if (![resultSet columnIsNull:@"manufacturer_id"]) {
+        NSString *manufacturer = [_manufacturerCache nameForID:[resultSet longLongIntForColumn:@"manufacturer_id"]];
+        if (manufacturer) {
+            [component setObject:manufacturer forKey:@"manufacturer"];
+        }
+    }
+    if (![resultSet columnIsNull:@"package_code_id"]) {
+        NSString *packageCode = [_packageCodeCache nameForID:[resultSet longLongIntForColumn:@"package_code_id"]];
+        if (packageCode) {
+            [component setObject:packageCode forKey:@"package_code"];
+        }
     }
     if (![resultSet columnIsNull:@"comments"]) {
         [component setObject:[resultSet stringForColumn:@"comments"] forKey:@"comments"];
     }
+    if (![resultSet columnIsNull:@"min_quantity"]) {
+        [component setObject:[NSNumber numberWithInteger:[resultSet longForColumn:@"min_quantity"]] forKey:@"min_quantity"];
+    }
     if (![resultSet columnIsNull:@"voltage_rating"]) {
         double voltage = [resultSet doubleForColumn:@"voltage_rating"];
         VoltageRating *voltageRating = [[VoltageRating alloc] initWithValue:voltage];
@@ -192,9 +786,182 @@
 }
 
 
-- (NSMutableArray<NSMutableDictionary *> *)incrementalSearchResultsForPartNumber:(NSString *)partNumber {
++ (NSSet<NSString *> *)sortableStockColumns {
+    static NSSet<NSString *> *columns = nil;
+    if (!columns) {
+        NSMutableSet<NSString *> *sortableColumns = [NSMutableSet setWithObjects:@"component_id", @"part_number", @"quantity", @"min_quantity", @"comments", nil];
+        for (NSInteger kind = 0; kind < (NSInteger)[[ComponentRating ratingNames] count]; kind++) {
+            [sortableColumns addObject:[ComponentRating columnNameForKind:kind]];
+        }
+        columns = [sortableColumns copy];
+    }
+    return columns;
+}
+
+
+/*
+ ORDER BY terms for sort descriptors, or nil when one names no stock column SQL orders as compare:
+ does, such as a name stored as its lookup table id or a derived value. Part numbers compared by
+ naturalCompare: order on their sort keys. NULLs go last in either direction, as in the results
+ table; SQLite puts them first when ascending, so later ascending nullable columns order on
+ "IS NULL" first. A leading one is left plain for the caller to split.
+ */
+- (nullable NSArray<NSString *> *)orderingTermsForSortDescriptors:(NSArray<NSSortDescriptor *> *)sortDescriptors
+                                                  nullableColumns:(NSSet<NSString *> *)nullableColumns {
+    NSMutableArray<NSString *> *orderingTerms = [[NSMutableArray alloc] initWithCapacity:[sortDescriptors count]];
+    for (NSSortDescriptor *sortDescriptor in sortDescriptors) {
+        NSString *column = [sortDescriptor key];
+        if ([column isEqualToString:@"part_number"] && [sortDescriptor selector] == @selector(naturalCompare:)) {
+            column = @"part_sort_key";
+        } else if (![[DatabaseController sortableStockColumns] containsObject:column] || [sortDescriptor selector] != @selector(compare:)) {
+            return nil;
+        }
+        if (![sortDescriptor ascending]) {
+            [orderingTerms addObject:[NSString stringWithFormat:@"\"%@\" DESC", column]];
+        } else if ([orderingTerms count] > 0 && [nullableColumns containsObject:column]) {
+            [orderingTerms addObject:[NSString stringWithFormat:@"\"%@\" IS NULL, \"%@\"", column, column]];
+        } else {
+            [orderingTerms addObject:[NSString stringWithFormat:@"\"%@\"", column]];
+        }
+    }
+    return orderingTerms;
+}
+
+
+/*
+ Rows of stock matching a predicate, ordered by SQL when the sort descriptors allow it and left in
+ table order otherwise; either way they are meant for SearchResultSorter, which then only checks
+ an order SQL produced. A leading ascending nullable column splits the query into its non-NULL
+ rows, which an index on the column returns in order, and its NULL rows after them.
+ */
+- (NSMutableArray<NSMutableDictionary *> *)searchResultsWhere:(NSString *)predicate
+                                                    arguments:(NSArray *)arguments
+                                              sortDescriptors:(NSArray<NSSortDescriptor *> *)sortDescriptors {
+    NSMutableArray<NSString *> *queries = [[NSMutableArray alloc] initWithCapacity:2];
+    NSSet<NSString *> *nullableColumns = [sortDescriptors count] > 0 ? [self nullableColumnsOfTable:@"stock"] : [NSSet set];
+    NSArray<NSString *> *orderingTerms = [self orderingTermsForSortDescriptors:sortDescriptors nullableColumns:nullableColumns];
+    NSSortDescriptor *leadingSortDescriptor = [sortDescriptors firstObject];
+    if ([orderingTerms count] == 0) {
+        [queries addObject:[NSString stringWithFormat:@"SELECT * FROM stock WHERE %@", predicate]];
+    } else if ([leadingSortDescriptor ascending] && [nullableColumns containsObject:[leadingSortDescriptor key]]) {
+        [queries addObject:[NSString stringWithFormat:@"SELECT * FROM stock WHERE (%@) AND \"%@\" IS NOT NULL ORDER BY %@",
+                            predicate, [leadingSortDescriptor key], [orderingTerms componentsJoinedByString:@", "]]];
+        NSArray<NSString *> *remainingTerms = [orderingTerms subarrayWithRange:NSMakeRange(1, [orderingTerms count] - 1)];
+        NSString *nullQuery = [NSString stringWithFormat:@"SELECT * FROM stock WHERE (%@) AND \"%@\" IS NULL", predicate, [leadingSortDescriptor key]];
+        if ([remainingTerms count] > 0) {
+            nullQuery = [nullQuery stringByAppendingFormat:@" ORDER BY %@", [remainingTerms componentsJoinedByString:@", "]];
+        }
+        [queries addObject:nullQuery];
+    } else {
+        [queries addObject:[NSString stringWithFormat:@"SELECT * FROM stock WHERE %@ ORDER BY %@",
+                            predicate, [orderingTerms componentsJoinedByString:@", "]]];
+    }
+    NSMutableArray<NSMutableDictionary *> *searchResults = [[NSMutableArray alloc] init];
+    for (NSString *query in queries) {
+        FMResultSet *resultSet = [_database executeQuery:query withArgumentsInArray:arguments];
+        while ([resultSet next]) {
+            [searchResults addObject:[self componentFromResultSet:resultSet]];
+        }
+        [resultSet close];
+    }
+    return searchResults;
+}
+
+
+- (NSMutableArray<NSMutableDictionary *> *)incrementalSearchResultsForPartNumber:(NSString *)partNumber
+                                                                  sortDescriptors:(NSArray<NSSortDescriptor *> *)sortDescriptors {
+    NSString *pattern = [partNumber stringByAppendingString:@"%"];
+    NSSortDescriptor *leadingSortDescriptor = [sortDescriptors firstObject];
+    if ([[leadingSortDescriptor key] isEqualToString:@"part_number"] && [leadingSortDescriptor selector] == @selector(naturalCompare:)) {
+        // Without a trailing digit run, which may go on with more digits, the prefix's sort key prefixes those of its matches,
+        // so the natural order index serves both the range and the order
+        NSRange lastNonDigit = [partNumber rangeOfCharacterFromSet:[[NSCharacterSet characterSetWithRange:NSMakeRange('0', 10)] invertedSet]
+                                                           options:NSBackwardsSearch];
+        NSString *stem = lastNonDigit.location == NSNotFound ? @"" : [partNumber substringToIndex:NSMaxRange(lastNonDigit)];
+        [self fillMissingPartSortKeys]; //Rows without a key would be left out
+        NSMutableString *keyPattern = [[stem naturalSortKey] mutableCopy];
+        for (NSString *metacharacter in @[@"[", @"*", @"?"]) {
+            [keyPattern replaceOccurrencesOfString:metacharacter
+                                        withString:[NSString stringWithFormat:@"[%@]", metacharacter]
+                                           options:0
+                                             range:NSMakeRange(0, [keyPattern length])];
+        }
+        [keyPattern appendString:@"*"];
+        return [self searchResultsWhere:@"part_sort_key GLOB ? AND part_number LIKE ?"
+                              arguments:@[keyPattern, pattern]
+                        sortDescriptors:sortDescriptors];
+    }
+    return [self searchResultsWhere:@"part_number LIKE ?" arguments:@[pattern] sortDescriptors:sortDescriptors];
+}
+
+
+- (NSMutableArray<NSMutableDictionary *> *)searchResultsForComponentType:(NSString *)type
+                                                         sortDescriptors:(NSArray<NSSortDescriptor *> *)sortDescriptors {
+    NSNumber *typeID = [_componentTypeCache identifierForName:type];
+    if (!typeID) {
+        return [[NSMutableArray alloc] init];
+    }
+    return [self searchResultsWhere:@"component_type_id = ?" arguments:@[typeID] sortDescriptors:sortDescriptors];
+}
+
+
+/*
+ Parameters are optional "component_type", "manufacturer" and "package_code" equalities and
+ "quantity" or "<rating column>" "_min" / "_max" inclusive bounds, as NSNumber or ComponentRating,
+ the same the columnar mirror filters on. Each combination of
+ parameters present maps to one SQL text, built once and bound by name, so FMDB's statement cache
+ keeps one prepared statement per combination while a filter is adjusted. Names are compared as
+ their lookup table ids.
+ */
+- (NSMutableArray<NSMutableDictionary *> *)searchResultsForParameters:(NSDictionary *)parameters {
+    if (_columnarMirror) {
+        // Filtered in memory; only the matching rows are read back
+        return [self searchResultsForComponentIDs:[_columnarMirror componentIDsMatchingParameters:parameters]];
+    }
+    NSMutableArray<NSString *> *keys = [[NSMutableArray alloc] initWithObjects:@"component_type", @"manufacturer", @"package_code", @"quantity_min", @"quantity_max", nil];
+    for (NSUInteger kind = 0; kind < [[ComponentRating ratingNames] count]; kind++) {
+        NSString *column = [ComponentRating columnNameForKind:kind];
+        [keys addObject:[column stringByAppendingString:@"_min"]];
+        [keys addObject:[column stringByAppendingString:@"_max"]];
+    }
+    uint32_t combination = 0;
+    NSMutableDictionary *arguments = [[NSMutableDictionary alloc] init];
+    for (NSUInteger i = 0; i < [keys count]; i++) {
+        id argument = [parameters objectForKey:keys[i]];
+        if (!argument) {
+            continue;
+        }
+        combination |= 1u << i;
+        if (i < 3) {
+            LookupTableCache *lookupTableCache = i == 0 ? _componentTypeCache : i == 1 ? _manufacturerCache : _packageCodeCache;
+            argument = [lookupTableCache identifierForName:argument];
+            if (!argument) {
+                return [[NSMutableArray alloc] init]; //Not a name in use, so nothing can match
+            }
+        }
+        [arguments setObject:[argument isKindOfClass:[ComponentRating class]] ? [NSNumber numberWithDouble:[argument value]] : argument
+                      forKey:keys[i]];
+    }
+    NSString *query = [_parametricQueries objectForKey:[NSNumber numberWithUnsignedInt:combination]];
+    if (!query) {
+        NSMutableArray<NSString *> *predicates = [[NSMutableArray alloc] init];
+        for (NSUInteger i = 0; i < [keys count]; i++) {
+            if (!(combination & (1u << i))) {
+                continue;
+            }
+            if (i < 3) {
+                [predicates addObject:[NSString stringWithFormat:@"%@_id = :%@", keys[i], keys[i]]];
+            } else {
+                NSString *column = [keys[i] substringToIndex:[keys[i] length] - 4];
+                [predicates addObject:[NSString stringWithFormat:@"%@ %@ :%@", column, [keys[i] hasSuffix:@"_min"] ? @">=" : @"<=", keys[i]]];
+            }
+        }
+        query = [predicates count] > 0 ? [@"SELECT * FROM stock WHERE " stringByAppendingString:[predicates componentsJoinedByString:@" AND "]]
+                                       : @"SELECT * FROM stock";
+        [_parametricQueries setObject:query forKey:[NSNumber numberWithUnsignedInt:combination]];
+    }
     NSMutableArray<NSMutableDictionary *> *searchResults = [[NSMutableArray alloc] init];
-    FMResultSet *resultSet = [_database executeQuery:@"SELECT * FROM stock WHERE part_number LIKE ?", [partNumber stringByAppendingString:@"%"]];
+    FMResultSet *resultSet = [_database executeQuery:query withParameterDictionary:arguments];
     while ([resultSet next]) {
         [searchResults addObject:[self componentFromResultSet:resultSet]];
     }
@@ -203,9 +970,41 @@
 }
 
 
-- (NSMutableArray<NSMutableDictionary *> *)searchResultsForComponentType:(NSString *)type {
+- (NSMutableArray<NSMutableDictionary *> *)searchResultsForComponentIDs:(NSArray<NSNumber *> *)componentIDs {
+    // One cached statement stepped per id; each is a rowid lookup
+    NSMutableArray<NSMutableDictionary *> *searchResults = [[NSMutableArray alloc] initWithCapacity:[componentIDs count]];
+    for (NSNumber *componentID in componentIDs) {
+        FMResultSet *resultSet = [_database executeQuery:@"SELECT * FROM stock WHERE component_id = ?", componentID];
+        if ([resultSet next]) {
+            [searchResults addObject:[self componentFromResultSet:resultSet]];
+        }
+        [resultSet close];
+    }
+    return searchResults;
+}
+
+
+- (NSMutableArray<NSMutableDictionary *> *)searchResultsForRatingValue:(double)value kind:(ComponentRatingKind)kind {
+    double margin = fabs(value) * RATING_MATCH_TOLERANCE;
+    if (kind != ComponentRatingKindUnknown) {
+        NSString *column = [ComponentRating columnNameForKind:kind];
+        return [self searchResultsForParameters:@{
+            [column stringByAppendingString:@"_min"] : [NSNumber numberWithDouble:value - margin],
+            [column stringByAppendingString:@"_max"] : [NSNumber numberWithDouble:value + margin]
+        }];
+    }
+    // A value typed without a unit may be any rating
+    NSMutableArray<NSString *> *predicates = [[NSMutableArray alloc] init];
+    for (NSInteger candidateKind = 0; candidateKind < (NSInteger)[[ComponentRating ratingNames] count]; candidateKind++) {
+        [predicates addObject:[NSString stringWithFormat:@"%@ BETWEEN :lower AND :upper", [ComponentRating columnNameForKind:candidateKind]]];
+    }
+    NSString *query = [NSString stringWithFormat:@"SELECT * FROM stock WHERE %@", [predicates componentsJoinedByString:@" OR "]];
+    NSDictionary *arguments = @{
+        @"lower" : [NSNumber numberWithDouble:value - margin],
+        @"upper" : [NSNumber numberWithDouble:value + margin]
+    };
     NSMutableArray<NSMutableDictionary *> *searchResults = [[NSMutableArray alloc] init];
-    FMResultSet *resultSet = [_database executeQuery:@"SELECT * FROM stock WHERE component_type = ?", type];
+    FMResultSet *resultSet = [_database executeQuery:query withParameterDictionary:arguments];
     while ([resultSet next]) {
         [searchResults addObject:[self componentFromResultSet:resultSet]];
     }
@@ -214,6 +1013,193 @@
 }
 
 
+/*
+ Distinct in-stock values of a resistance, capacitance or inductance closest to a target in log
+ space, nearest first. Filters are an optional "package_code" equality and a "tolerance_rating_max"
+ bound. Each side of the target is one range scan of a partial index of stocked parts, reading at
+ most count values, and the two are merged by distance. Entries hold the "value" as a rating, its
+ "deviation" from the target in percent, the smallest "e_series" holding it with its
+ "e_series_index" there, and the in-stock "components" of that value.
+ */
+- (NSArray<NSDictionary *> *)nearestStockedValuesTo:(double)target
+                                               kind:(ComponentRatingKind)kind
+                                              count:(NSUInteger)count
+                                            filters:(NSDictionary *)filters {
+    if (!(target > 0.0) || count == 0
+        || (kind != ComponentRatingKindResistance && kind != ComponentRatingKindCapacitance && kind != ComponentRatingKindInductance)) {
+        return @[];
+    }
+    NSString *column = [ComponentRating columnNameForKind:kind];
+    NSMutableString *predicates = [[NSMutableString alloc] initWithString:@"quantity > 0"]; //Selects the partial index
+    NSMutableDictionary *arguments = [[NSMutableDictionary alloc] init];
+    [arguments setObject:[NSNumber numberWithDouble:target] forKey:@"target"];
+    [arguments setObject:[NSNumber numberWithUnsignedInteger:count] forKey:@"limit"];
+    if ([filters objectForKey:@"package_code"]) {
+        NSNumber *packageCodeID = [_packageCodeCache identifierForName:[filters objectForKey:@"package_code"]];
+        if (!packageCodeID) {
+            return @[];
+        }
+        [predicates appendString:@" AND package_code_id = :package_code_id"];
+        [arguments setObject:packageCodeID forKey:@"package_code_id"];
+    }
+    if ([filters objectForKey:@"tolerance_rating_max"]) {
+        id tolerance = [filters objectForKey:@"tolerance_rating_max"];
+        [predicates appendString:@" AND tolerance_rating <= :tolerance_rating_max"];
+        [arguments setObject:[tolerance isKindOfClass:[ComponentRating class]] ? [NSNumber numberWithDouble:[tolerance value]] : tolerance
+                      forKey:@"tolerance_rating_max"];
+    }
+    NSString *aboveQuery = [NSString stringWithFormat:@"SELECT DISTINCT %@ FROM stock WHERE %@ AND %@ >= :target ORDER BY %@ LIMIT :limit",
+                            column, predicates, column, column];
+    NSString *belowQuery = [NSString stringWithFormat:@"SELECT DISTINCT %@ FROM stock WHERE %@ AND %@ < :target AND %@ > 0 ORDER BY %@ DESC LIMIT :limit",
+                            column, predicates, column, column, column];
+    NSMutableArray<NSNumber *> *aboveValues = [[NSMutableArray alloc] init];
+    NSMutableArray<NSNumber *> *belowValues = [[NSMutableArray alloc] init];
+    for (NSUInteger side = 0; side < 2; side++) {
+        NSMutableArray<NSNumber *> *values = side == 0 ? aboveValues : belowValues;
+        FMResultSet *resultSet = [_database executeQuery:side == 0 ? aboveQuery : belowQuery withParameterDictionary:arguments];
+        while ([resultSet next]) {
+            [values addObject:[NSNumber numberWithDouble:[resultSet doubleForColumnIndex:0]]];
+        }
+        [resultSet close];
+    }
+    NSString *componentsQuery = [NSString stringWithFormat:@"SELECT * FROM stock WHERE %@ AND %@ = :value ORDER BY part_number", predicates, column];
+    NSArray<NSNumber *> *seriesSizes = @[@3, @6, @12, @24, @48, @96, @192];
+    NSMutableArray<NSDictionary *> *nearestValues = [[NSMutableArray alloc] init];
+    NSUInteger above = 0;
+    NSUInteger below = 0;
+    while ([nearestValues count] < count && (above < [aboveValues count] || below < [belowValues count])) {
+        BOOL takesAbove = below == [belowValues count]
+            || (above < [aboveValues count] && log([aboveValues[above] doubleValue] / target) <= log(target / [belowValues[below] doubleValue]));
+        double value = takesAbove ? [aboveValues[above++] doubleValue] : [belowValues[below++] doubleValue];
+        NSMutableDictionary *entry = [[NSMutableDictionary alloc] init];
+        [entry setObject:[[[ComponentRating ratingClassForKind:kind] alloc] initWithValue:value] forKey:@"value"];
+        [entry setObject:[NSNumber numberWithDouble:(value / target - 1.0) * 100.0] forKey:@"deviation"];
+        for (NSNumber *series in seriesSizes) {
+            NSInteger index = ComponentRatingESeriesIndex(value, [series integerValue]);
+            if (index >= 0) {
+                [entry setObject:series forKey:@"e_series"];
+                [entry setObject:[NSNumber numberWithInteger:index] forKey:@"e_series_index"];
+                break;
+            }
+        }
+        [arguments setObject:[NSNumber numberWithDouble:value] forKey:@"value"];
+        NSMutableArray<NSMutableDictionary *> *components = [[NSMutableArray alloc] init];
+        FMResultSet *resultSet = [_database executeQuery:componentsQuery withParameterDictionary:arguments];
+        while ([resultSet next]) {
+            [components addObject:[self componentFromResultSet:resultSet]];
+        }
+        [resultSet close];
+        [entry setObject:components forKey:@"components"];
+        [nearestValues addObject:entry];
+    }
+    return nearestValues;
+}
+
+
+/*
+ Series and parallel networks of two, or also three, stocked resistors or capacitors within a
+ tolerance in percent of the target, best first. Each entry holds the part "values" as ratings,
+ the "topology" ("series" or "parallel"), the resulting "value" and its "deviation" in percent.
+ Distinct values and their units in stock are read in order from the partial index of stocked parts.
+ */
+- (NSArray<NSDictionary *> *)combinationsForTarget:(double)target
+                                              kind:(ComponentRatingKind)kind
+                                         tolerance:(double)tolerance
+                                   includesTriples:(BOOL)includesTriples
+                                             limit:(NSUInteger)limit {
+    if (kind != ComponentRatingKindResistance && kind != ComponentRatingKindCapacitance) {
+        return @[];
+    }
+    NSString *column = [ComponentRating columnNameForKind:kind];
+    NSString *query = [NSString stringWithFormat:@"SELECT %@, SUM(quantity) FROM stock WHERE quantity > 0 AND %@ > 0 GROUP BY %@ ORDER BY %@",
+                       column, column, column, column];
+    NSMutableArray<NSNumber *> *values = [[NSMutableArray alloc] init];
+    NSMutableArray<NSNumber *> *quantities = [[NSMutableArray alloc] init];
+    FMResultSet *resultSet = [_database executeQuery:query];
+    while ([resultSet next]) {
+        [values addObject:[NSNumber numberWithDouble:[resultSet doubleForColumnIndex:0]]];
+        [quantities addObject:[NSNumber numberWithLongLong:[resultSet longLongIntForColumnIndex:1]]];
+    }
+    [resultSet close];
+    NSArray<NSDictionary *> *combinations = [CombinationFinder combinationsOfValues:values
+                                                                         quantities:quantities
+                                                                             target:target
+                                                                          tolerance:tolerance
+                                                                    includesTriples:includesTriples
+                                                                              limit:limit];
+    Class ratingClass = [ComponentRating ratingClassForKind:kind];
+    NSMutableArray<NSDictionary *> *networks = [[NSMutableArray alloc] initWithCapacity:[combinations count]];
+    for (NSDictionary *combination in combinations) {
+        NSMutableArray<ComponentRating *> *partValues = [[NSMutableArray alloc] init];
+        for (NSNumber *partValue in [combination objectForKey:@"values"]) {
+            [partValues addObject:[[ratingClass alloc] initWithValue:[partValue doubleValue]]];
+        }
+        // Resistances add in series, capacitances in parallel
+        BOOL isSeries = (kind == ComponentRatingKindResistance) == [[combination objectForKey:@"additive"] boolValue];
+        [networks addObject:@{
+            @"values" : partValues,
+            @"topology" : isSeries ? @"series" : @"parallel",
+            @"value" : [[ratingClass alloc] initWithValue:[[combination objectForKey:@"value"] doubleValue]],
+            @"deviation" : [combination objectForKey:@"deviation"]
+        }];
+    }
+    return networks;
+}
+
+
+/*
+ In-stock components that can replace the given one, nearest in ratings first: same type and
+ package code, no lower voltage, current or power rating, values within the original's tolerance
+ and a tolerance at least as tight.
+ */
+- (NSMutableArray<NSMutableDictionary *> *)substitutesForComponentID:(NSNumber *)componentID limit:(NSUInteger)limit {
+    if (!_substituteIndex) {
+        [self setSubstituteIndex:[[SubstituteIndex alloc] initWithDatabase:_database notificationSender:self]];
+    }
+    return [self searchResultsForComponentIDs:[_substituteIndex substituteIDsForComponentID:componentID limit:limit]];
+}
+
+
+- (NSMutableArray<NSMutableDictionary *> *)searchResultsBelowMinimumQuantity {
+    // Served by the partial index stock_below_minimum, so the cost follows the number of alerts
+    NSMutableArray<NSMutableDictionary *> *queryResults = [[NSMutableArray alloc] init];
+    FMResultSet *resultSet = [_database executeQuery:@"SELECT * FROM stock WHERE quantity < min_quantity ORDER BY part_number"];
+    while ([resultSet next]) {
+        [queryResults addObject:[self componentFromResultSet:resultSet]];
+    }
+    [resultSet close];
+    return queryResults;
+}
+
+
+- (NSUInteger)countOfComponentsBelowMinimumQuantity {
+    NSUInteger count = 0;
+    FMResultSet *resultSet = [_database executeQuery:@"SELECT COUNT(*) FROM stock WHERE quantity < min_quantity"];
+    if ([resultSet next]) {
+        count = (NSUInteger)[resultSet longForColumnIndex:0];
+    }
+    [resultSet close];
+    return count;
+}
+
+
+- (NSMutableArray<NSMutableDictionary *> *)searchResultsRunningOutSoonest {
+    NSArray<NSDictionary *> *forecasts = [ConsumptionForecaster forecastsRunningOutSoonestInDatabase:_database
+                                                                                              limit:FORECAST_RESULT_LIMIT];
+    NSMutableArray<NSMutableDictionary *> *queryResults = [[NSMutableArray alloc] init];
+    for (NSDictionary *forecast in forecasts) {
+        FMResultSet *resultSet = [_database executeQuery:@"SELECT * FROM stock WHERE component_id = ?", [forecast objectForKey:@"component_id"]];
+        if ([resultSet next]) {
+            NSMutableDictionary *component = [self componentFromResultSet:resultSet];
+            [component setObject:[forecast objectForKey:@"days_remaining"] forKey:@"days_remaining"];
+            [queryResults addObject:component];
+        }
+        [resultSet close];
+    }
+    return queryResults;
+}
+
+
 - (NSMutableArray<NSDictionary *> *)stockReplenishmentsForComponentID:(NSNumber *)component_id {
     NSMutableArray<NSDictionary *> *queryResults = [[NSMutableArray alloc] init];
     FMResultSet *resultSet = [_database executeQuery:@"SELECT id, quantity, date_acquired, origin FROM acquisitions WHERE fk_component_id = ? ORDER BY date_acquired DESC", component_id];
@@ -259,7 +1245,11 @@
 - (nullable NSMutableDictionary *)recordForPartNumber:(NSString *)partNumber
                                          manufacturer:(NSString *)manufacturer {
     NSMutableDictionary *record = nil;
-    FMResultSet *resultSet = [_database executeQuery:@"SELECT * FROM stock WHERE part_number = ? AND manufacturer = ?", partNumber, manufacturer ?: @"NULL"];
+    NSNumber *manufacturerID = [manufacturer length] > 0 ? [_manufacturerCache identifierForName:manufacturer] : @0;
+    if (!manufacturerID) {
+        return nil;
+    }
+    FMResultSet *resultSet = [_database executeQuery:@"SELECT * FROM stock WHERE part_number = ? AND IFNULL(manufacturer_id, 0) = ?", partNumber, manufacturerID];
     [resultSet next];
     if ([resultSet columnCount]) {
         record = [self componentFromResultSet:resultSet];
@@ -269,20 +1259,81 @@
 }
 
 
+- (NSMutableArray<NSMutableDictionary *> *)similarRecordsForPartNumber:(NSString *)partNumber {
+    NSMutableArray<NSMutableDictionary *> *records = [[NSMutableArray alloc] init];
+    FMResultSet *resultSet = [_database executeQuery:@"SELECT * FROM stock WHERE part_key = " NORMALIZED_KEY("?") " ORDER BY manufacturer_key", partNumber];
+    while ([resultSet next]) {
+        [records addObject:[self componentFromResultSet:resultSet]];
+    }
+    [resultSet close];
+    return records;
+}
+
+
+- (NSArray<NSArray<NSMutableDictionary *> *> *)duplicateComponentClusters {
+    // Groups come out of the normalized key index already sorted, so clustering is a single pass
+    NSMutableArray<NSArray<NSMutableDictionary *> *> *clusters = [[NSMutableArray alloc] init];
+    FMResultSet *resultSet = [_database executeQuery:@"SELECT stock.* FROM stock JOIN (SELECT part_key, manufacturer_key FROM stock GROUP BY part_key, manufacturer_key HAVING COUNT(*) > 1) AS duplicates USING (part_key, manufacturer_key) ORDER BY part_key, manufacturer_key, component_id"];
+    NSMutableArray<NSMutableDictionary *> *cluster = nil;
+    NSString *clusterPartKey = nil;
+    NSString *clusterManufacturerKey = nil;
+    while ([resultSet next]) {
+        NSString *partKey = [resultSet stringForColumn:@"part_key"];
+        NSString *manufacturerKey = [resultSet stringForColumn:@"manufacturer_key"];
+        if (![partKey isEqualToString:clusterPartKey] || ![manufacturerKey isEqualToString:clusterManufacturerKey]) {
+            cluster = [[NSMutableArray alloc] init];
+            [clusters addObject:cluster];
+            clusterPartKey = partKey;
+            clusterManufacturerKey = manufacturerKey;
+        }
+        [cluster addObject:[self componentFromResultSet:resultSet]];
+    }
+    [resultSet close];
+    return clusters;
+}
+
+
 - (void)stockReplenishmentWithParameters:(NSDictionary *)parameters {
     [_database beginExclusiveTransaction];
     NSNumber *componentID = [parameters objectForKey:@"component_id"];
     NSNumber *quantity = [parameters objectForKey:@"quantity"];
-    [_database executeUpdate:@"UPDATE OR ROLLBACK stock SET quantity = quantity + ? WHERE component_id = ?", quantity, componentID];
     NSDate *dateAcquired = [parameters objectForKey:@"date_acquired"];
     NSString *origin = [parameters objectForKey:@"origin"];
-    [_database executeUpdate:@"INSERT OR ROLLBACK INTO acquisitions(fk_component_id, quantity, date_acquired, origin) VALUES(?, ?, ?, ?)", componentID, quantity, FMDB_SQL_NULLABLE(dateAcquired), FMDB_SQL_NULLABLE(origin)];
+    BOOL success = [_database executeUpdate:@"UPDATE stock SET quantity = quantity + ? WHERE component_id = ?", quantity, componentID] && [_database changes] == 1
+                && [_database executeUpdate:@"INSERT INTO acquisitions(fk_component_id, quantity, date_acquired, origin) VALUES(?, ?, ?, ?)", componentID, quantity, FMDB_SQL_NULLABLE(dateAcquired), FMDB_SQL_NULLABLE(origin)];
+    if (!success) {
+        NSLog(@"Controller failed to replenish stock: %@", [_database lastErrorMessage]);
+        [_database rollback];
+        return;
+    }
+    NSNumber *acquisitionID = [NSNumber numberWithLongLong:[_database lastInsertRowId]];
+    NSNumber *updatedQuantity = [self stockForComponentID:componentID]; //Row is still hot inside the transaction
+    NSNumber *minimumQuantity = [self minimumQuantityForComponentID:componentID];
     [_database commit];
+    [self journalMovementRecord:@{
+        @"id"               : acquisitionID,
+        @"fk_component_id"  : componentID,
+        @"quantity"         : quantity,
+        @"date_acquired"    : FMDB_SQL_NULLABLE(dateAcquired),
+        @"origin"           : FMDB_SQL_NULLABLE(origin)
+    } table:@"acquisitions" consumptionDate:nil actionName:@"Replenishment"];
+    // Listeners update from the payload instead of querying the database again
     [[NSNotificationCenter defaultCenter] postNotificationName:@"DBCStockUpdatedNotification"
                                                         object:self
                                                       userInfo:@{
-                                                          @"UpdatedComponentID" : componentID
+                                                          @"UpdatedComponentID" : componentID,
+                                                          @"UpdatedQuantity"    : updatedQuantity,
+                                                          @"Replenishment"      : @{
+                                                              @"id"             : acquisitionID,
+                                                              @"quantity"       : quantity,
+                                                              @"date_acquired"  : FMDB_SQL_NULLABLE(dateAcquired),
+                                                              @"origin"         : FMDB_SQL_NULLABLE(origin)
+                                                          }
                                                       }];
+    [self postLowStockNotificationForComponentID:componentID
+                                        quantity:[updatedQuantity integerValue]
+                                 minimumQuantity:minimumQuantity
+                                 wasBelowMinimum:minimumQuantity && [updatedQuantity integerValue] - [quantity integerValue] < [minimumQuantity integerValue]];
 }
 
 
@@ -290,16 +1341,67 @@
     [_database beginExclusiveTransaction];
     NSNumber *componentID = [parameters objectForKey:@"component_id"];
     NSNumber *quantity = [parameters objectForKey:@"quantity"];
-    [_database executeUpdate:@"UPDATE OR ROLLBACK stock SET quantity = quantity - ? WHERE component_id = ?", quantity, componentID];
     NSDate *dateSpent = [parameters objectForKey:@"date_spent"];
     NSString *destination = [parameters objectForKey:@"destination"];
-    [_database executeUpdate:@"INSERT OR ROLLBACK INTO expenditures(fk_component_id, quantity, date_spent, destination) VALUES(?, ?, ?, ?)", componentID, quantity, FMDB_SQL_NULLABLE(dateSpent), FMDB_SQL_NULLABLE(destination)];
+    // Withdrawing more than is in stock violates the quantity check; nothing is recorded then
+    BOOL success = [_database executeUpdate:@"UPDATE stock SET quantity = quantity - ? WHERE component_id = ?", quantity, componentID] && [_database changes] == 1
+                && [_database executeUpdate:@"INSERT INTO expenditures(fk_component_id, quantity, date_spent, destination) VALUES(?, ?, ?, ?)", componentID, quantity, FMDB_SQL_NULLABLE(dateSpent), FMDB_SQL_NULLABLE(destination)];
+    if (!success) {
+        NSLog(@"Controller failed to withdraw stock: %@", [_database lastErrorMessage]);
+        [_database rollback];
+        return;
+    }
+    NSNumber *expenditureID = [NSNumber numberWithLongLong:[_database lastInsertRowId]];
+    NSDate *consumptionDate = dateSpent ?: [NSDate date]; //Kept so undo removes exactly what was added
+    if (![ConsumptionForecaster recordExpenditureOfQuantity:[quantity integerValue] componentID:componentID date:consumptionDate inDatabase:_database]) {
+        NSLog(@"Controller failed to update consumption rates: %@", [_database lastErrorMessage]);
+        [_database rollback];
+        return;
+    }
+    NSNumber *updatedQuantity = [self stockForComponentID:componentID];
+    NSNumber *minimumQuantity = [self minimumQuantityForComponentID:componentID];
     [_database commit];
+    [self journalMovementRecord:@{
+        @"id"               : expenditureID,
+        @"fk_component_id"  : componentID,
+        @"quantity"         : quantity,
+        @"date_spent"       : FMDB_SQL_NULLABLE(dateSpent),
+        @"destination"      : FMDB_SQL_NULLABLE(destination)
+    } table:@"expenditures" consumptionDate:consumptionDate actionName:@"Withdrawal"];
     [[NSNotificationCenter defaultCenter] postNotificationName:@"DBCStockUpdatedNotification"
                                                         object:self
                                                       userInfo:@{
-                                                          @"UpdatedComponentID" : componentID
+                                                          @"UpdatedComponentID" : componentID,
+                                                          @"UpdatedQuantity"    : updatedQuantity,
+                                                          @"Withdrawal"         : @{
+                                                              @"id"             : expenditureID,
+                                                              @"quantity"       : quantity,
+                                                              @"date_spent"     : FMDB_SQL_NULLABLE(dateSpent),
+                                                              @"destination"    : FMDB_SQL_NULLABLE(destination)
+                                                          }
                                                       }];
+    // Alerts are re-evaluated for this component only, the moment the withdrawal crosses its threshold
+    [self postLowStockNotificationForComponentID:componentID
+                                        quantity:[updatedQuantity integerValue]
+                                 minimumQuantity:minimumQuantity
+                                 wasBelowMinimum:minimumQuantity && [updatedQuantity integerValue] + [quantity integerValue] < [minimumQuantity integerValue]];
+}
+
+
+// Id of a name in a lookup table, adding the name if it's new; runs within the transaction storing the id
+- (nullable NSNumber *)lookupIDForName:(NSString *)name table:(NSString *)table {
+    NSString *insertion = [NSString stringWithFormat:@"INSERT INTO %@(name) VALUES (?) ON CONFLICT(name) DO NOTHING", table];
+    if (![_database executeUpdate:insertion, name]) {
+        return nil;
+    }
+    NSNumber *identifier = nil;
+    NSString *query = [NSString stringWithFormat:@"SELECT id FROM %@ WHERE name = ?", table];
+    FMResultSet *resultSet = [_database executeQuery:query, name];
+    if ([resultSet next]) {
+        identifier = [NSNumber numberWithLongLong:[resultSet longLongIntForColumnIndex:0]];
+    }
+    [resultSet close];
+    return identifier;
 }
 
 
@@ -351,28 +1453,871 @@
     if (rating) {
         toleranceRating = [NSNumber numberWithDouble:[rating value]];
     }
-    [_database executeUpdate:@"INSERT OR ROLLBACK INTO stock(quantity, part_number, component_type, manufacturer, package_code, comments, voltage_rating, current_rating, power_rating, resistance_rating, inductance_rating, capacitance_rating, frequency_rating, tolerance_rating) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)", quantity, partNumber, componentType, FMDB_SQL_NULLABLE(manufacturer), FMDB_SQL_NULLABLE(packageCode), FMDB_SQL_NULLABLE(comments), FMDB_SQL_NULLABLE(voltageRating), FMDB_SQL_NULLABLE(currentRating), FMDB_SQL_NULLABLE(powerRating), FMDB_SQL_NULLABLE(resistanceRating), FMDB_SQL_NULLABLE(inductanceRating), FMDB_SQL_NULLABLE(capacitanceRating), FMDB_SQL_NULLABLE(frequencyRating), FMDB_SQL_NULLABLE(toleranceRating)];
-    FMResultSet *resultSet = [_database executeQuery:@"SELECT last_insert_rowid() AS new_component_id"];
-    [resultSet next];
-    if (![resultSet columnCount]) {
-        NSLog(@"Controller failed to retrieve last inserted row ID.");
+    NSNumber *componentTypeID = [self lookupIDForName:componentType table:@"component_types"];
+    NSNumber *manufacturerID = manufacturer ? [self lookupIDForName:manufacturer table:@"manufacturers"] : nil;
+    NSNumber *packageCodeID = packageCode ? [self lookupIDForName:packageCode table:@"package_codes"] : nil;
+    if (!componentTypeID || (manufacturer && !manufacturerID) || (packageCode && !packageCodeID)) {
+        NSLog(@"Controller failed to register component: %@", [_database lastErrorMessage]);
+        [_database rollback];
+        return;
+    }
+    // A part already on record only has its stock replenished; the parameters describing it are ignored
+    BOOL success = [_database executeUpdate:@"INSERT OR ROLLBACK INTO stock(quantity, part_number, part_sort_key, component_type_id, manufacturer_id, package_code_id, comments, voltage_rating, current_rating, power_rating, resistance_rating, inductance_rating, capacitance_rating, frequency_rating, tolerance_rating) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) ON CONFLICT(part_number, IFNULL(manufacturer_id, 0)) DO NOTHING", quantity, partNumber, [partNumber naturalSortKey], componentTypeID, FMDB_SQL_NULLABLE(manufacturerID), FMDB_SQL_NULLABLE(packageCodeID), FMDB_SQL_NULLABLE(comments), FMDB_SQL_NULLABLE(voltageRating), FMDB_SQL_NULLABLE(currentRating), FMDB_SQL_NULLABLE(powerRating), FMDB_SQL_NULLABLE(resistanceRating), FMDB_SQL_NULLABLE(inductanceRating), FMDB_SQL_NULLABLE(capacitanceRating), FMDB_SQL_NULLABLE(frequencyRating), FMDB_SQL_NULLABLE(toleranceRating)];
+    // Only the statement's own rows count as changes, not those of its triggers or of earlier inserts
+    BOOL isNewComponent = success && [_database changes] > 0;
+    NSNumber *componentID = nil;
+    if (isNewComponent) {
+        componentID = [NSNumber numberWithLongLong:[_database lastInsertRowId]];
+    } else if (success) {
+        FMResultSet *resultSet = [_database executeQuery:@"SELECT component_id FROM stock WHERE part_number = ? AND IFNULL(manufacturer_id, 0) = ?", partNumber, manufacturerID ?: @0];
+        if ([resultSet next]) {
+            componentID = [NSNumber numberWithInteger:[resultSet longForColumn:@"component_id"]];
+        }
         [resultSet close];
+        if (componentID && ![_database executeUpdate:@"UPDATE stock SET quantity = quantity + ? WHERE component_id = ?", quantity, componentID]) {
+            componentID = nil;
+        }
+    }
+    if (!componentID) {
+        NSLog(@"Controller failed to register component: %@", [_database lastErrorMessage]);
+        [_database rollback];
         return;
     }
-    NSNumber *newComponentID = [NSNumber numberWithInteger:[resultSet longForColumn:@"new_component_id"]];
-    [resultSet close];
     NSDate *dateAcquired = [parameters objectForKey:@"date_acquired"];
     NSString *origin = [parameters objectForKey:@"origin"];
-    [_database executeUpdate:@"INSERT OR ROLLBACK INTO acquisitions(fk_component_id, quantity, date_acquired, origin) VALUES(?, ?, ?, ?)", newComponentID, quantity, FMDB_SQL_NULLABLE(dateAcquired), FMDB_SQL_NULLABLE(origin)];
+    if (![_database executeUpdate:@"INSERT INTO acquisitions(fk_component_id, quantity, date_acquired, origin) VALUES(?, ?, ?, ?)", componentID, quantity, FMDB_SQL_NULLABLE(dateAcquired), FMDB_SQL_NULLABLE(origin)]) {
+        NSLog(@"Controller failed to register component: %@", [_database lastErrorMessage]);
+        [_database rollback];
+        return;
+    }
+    NSDictionary *acquisitionRecord = @{
+        @"id"               : [NSNumber numberWithLongLong:[_database lastInsertRowId]],
+        @"fk_component_id"  : componentID,
+        @"quantity"         : quantity,
+        @"date_acquired"    : FMDB_SQL_NULLABLE(dateAcquired),
+        @"origin"           : FMDB_SQL_NULLABLE(origin)
+    };
+    if (isNewComponent) {
+        NSDictionary *componentRecord = nil;
+        FMResultSet *resultSet = [_database executeQuery:@"SELECT * FROM stock WHERE component_id = ?", componentID];
+        if ([resultSet next]) {
+            componentRecord = [resultSet resultDictionary];
+        }
+        [resultSet close];
+        [_database commit];
+        if (componentRecord) {
+            [self journalRegistrationOfComponentRecord:componentRecord acquisitionRecord:acquisitionRecord];
+        }
+        [[NSNotificationCenter defaultCenter] postNotificationName:@"DBCComponentRegisteredNotification"
+                                                            object:self
+                                                          userInfo:@{
+                                                              @"ComponentID"  : componentID,
+                                                              @"PartNumber"   : partNumber
+                                                          }];
+    } else {
+        NSNumber *acquisitionID = [acquisitionRecord objectForKey:@"id"];
+        NSNumber *updatedQuantity = [self stockForComponentID:componentID];
+        NSNumber *minimumQuantity = [self minimumQuantityForComponentID:componentID];
+        [_database commit];
+        [self journalMovementRecord:acquisitionRecord table:@"acquisitions" consumptionDate:nil actionName:@"Replenishment"];
+        [[NSNotificationCenter defaultCenter] postNotificationName:@"DBCStockUpdatedNotification"
+                                                            object:self
+                                                          userInfo:@{
+                                                              @"UpdatedComponentID" : componentID,
+                                                              @"UpdatedQuantity"    : updatedQuantity,
+                                                              @"Replenishment"      : @{
+                                                                  @"id"             : acquisitionID,
+                                                                  @"quantity"       : quantity,
+                                                                  @"date_acquired"  : FMDB_SQL_NULLABLE(dateAcquired),
+                                                                  @"origin"         : FMDB_SQL_NULLABLE(origin)
+                                                              }
+                                                          }];
+        [self postLowStockNotificationForComponentID:componentID
+                                            quantity:[updatedQuantity integerValue]
+                                     minimumQuantity:minimumQuantity
+                                     wasBelowMinimum:minimumQuantity && [updatedQuantity integerValue] - [quantity integerValue] < [minimumQuantity integerValue]];
+    }
+}
+
+
+- (void)setMinimumQuantity:(nullable NSNumber *)minimumQuantity forComponentID:(NSNumber *)componentID {
+    [_database beginExclusiveTransaction];
+    NSNumber *previousMinimumQuantity = [self minimumQuantityForComponentID:componentID];
+    if (![_database executeUpdate:@"UPDATE OR ROLLBACK stock SET min_quantity = ? WHERE component_id = ?", FMDB_SQL_NULLABLE(minimumQuantity), componentID]) {
+        NSLog(@"Controller failed to set minimum quantity: %@", [_database lastErrorMessage]);
+        [_database rollback];
+        return;
+    }
+    NSNumber *quantity = [self stockForComponentID:componentID];
+    [_database commit];
+    [self postLowStockNotificationForComponentID:componentID
+                                        quantity:[quantity integerValue]
+                                 minimumQuantity:minimumQuantity
+                                 wasBelowMinimum:previousMinimumQuantity && [quantity integerValue] < [previousMinimumQuantity integerValue]];
+}
+
+
+- (nullable NSNumber *)setQuantity:(NSNumber *)quantity
+                    forComponentID:(NSNumber *)componentID
+            inBillOfMaterialsNamed:(NSString *)name {
+    // The bill is created with its first line; a component already listed has its units per build replaced
+    [_database beginExclusiveTransaction];
+    NSNumber *bomID = nil;
+    if ([_database executeUpdate:@"INSERT INTO boms(name) VALUES (?) ON CONFLICT(name) DO NOTHING", name]) {
+        FMResultSet *resultSet = [_database executeQuery:@"SELECT id FROM boms WHERE name = ?", name];
+        if ([resultSet next]) {
+            bomID = [NSNumber numberWithLongLong:[resultSet longLongIntForColumnIndex:0]];
+        }
+        [resultSet close];
+    }
+    if (!bomID || ![_database executeUpdate:@"INSERT INTO bom_lines(fk_bom_id, fk_component_id, quantity) VALUES (?, ?, ?) ON CONFLICT(fk_bom_id, fk_component_id) DO UPDATE SET quantity = excluded.quantity", bomID, componentID, quantity]) {
+        NSLog(@"Controller failed to update bill of materials: %@", [_database lastErrorMessage]);
+        [_database rollback];
+        return nil;
+    }
+    [_database commit];
+    return bomID;
+}
+
+
+- (NSArray<NSDictionary *> *)billsOfMaterials {
+    NSMutableArray<NSDictionary *> *queryResults = [[NSMutableArray alloc] init];
+    FMResultSet *resultSet = [_database executeQuery:@"SELECT id, name, (SELECT COUNT(*) FROM bom_lines WHERE fk_bom_id = boms.id) AS line_count FROM boms ORDER BY name"];
+    while ([resultSet next]) {
+        [queryResults addObject:@{
+            @"id"           : [NSNumber numberWithLongLong:[resultSet longLongIntForColumn:@"id"]],
+            @"name"         : [resultSet stringForColumn:@"name"],
+            @"line_count"   : [NSNumber numberWithLongLong:[resultSet longLongIntForColumn:@"line_count"]]
+        }];
+    }
+    [resultSet close];
+    return queryResults;
+}
+
+
+- (NSUInteger)buildableCountForBillOfMaterialsID:(NSNumber *)bomID {
+    // Set-based: the scarcest line bounds the builds, one primary key probe per line
+    NSUInteger buildableCount = 0;
+    FMResultSet *resultSet = [_database executeQuery:@"SELECT IFNULL(MIN(stock.quantity / bom_lines.quantity), 0) FROM bom_lines JOIN stock ON stock.component_id = bom_lines.fk_component_id WHERE fk_bom_id = ?", bomID];
+    if ([resultSet next]) {
+        buildableCount = (NSUInteger)[resultSet longLongIntForColumnIndex:0];
+    }
+    [resultSet close];
+    return buildableCount;
+}
+
+
+- (BOOL)kitWithdrawalWithParameters:(NSDictionary *)parameters {
+    NSNumber *bomID = [parameters objectForKey:@"bom_id"];
+    NSNumber *builds = [parameters objectForKey:@"builds"];
+    NSDate *dateSpent = [parameters objectForKey:@"date_spent"];
+    NSString *destination = [parameters objectForKey:@"destination"];
+    [_database beginExclusiveTransaction];
+    if ([self buildableCountForBillOfMaterialsID:bomID] < [builds unsignedIntegerValue]) {
+        NSLog(@"Controller refused kit withdrawal: not enough stock for %@ builds.", builds);
+        [_database rollback];
+        return NO;
+    }
+    NSDate *consumptionDate = dateSpent ?: [NSDate date]; //Kept so undo removes exactly what was added
+    NSNumber *lastExpenditureID = [NSNumber numberWithLong:[_database longForQuery:@"SELECT IFNULL(MAX(id), 0) FROM expenditures"]];
+    // One statement each for the stock and the expenditures of every line
+    BOOL success = [_database executeUpdate:@"UPDATE stock SET quantity = quantity - ? * (SELECT bom_lines.quantity FROM bom_lines WHERE fk_bom_id = ? AND fk_component_id = stock.component_id) WHERE component_id IN (SELECT fk_component_id FROM bom_lines WHERE fk_bom_id = ?)", builds, bomID, bomID]
+                && [_database executeUpdate:@"INSERT INTO expenditures(fk_component_id, quantity, date_spent, destination) SELECT fk_component_id, quantity * ?, ?, ? FROM bom_lines WHERE fk_bom_id = ?", builds, FMDB_SQL_NULLABLE(dateSpent), FMDB_SQL_NULLABLE(destination), bomID];
+    // The transaction is exclusive, so every expenditure past the previous last one is this kit's
+    NSMutableArray<NSDictionary *> *expenditureRecords = [[NSMutableArray alloc] init];
+    FMResultSet *resultSet = success ? [_database executeQuery:@"SELECT * FROM expenditures WHERE id > ?", lastExpenditureID] : nil;
+    while ([resultSet next]) {
+        [expenditureRecords addObject:[resultSet resultDictionary]];
+    }
+    [resultSet close];
+    for (NSDictionary *expenditureRecord in expenditureRecords) {
+        if (!success) {
+            break;
+        }
+        success = [ConsumptionForecaster recordExpenditureOfQuantity:[[expenditureRecord objectForKey:@"quantity"] integerValue]
+                                                         componentID:[expenditureRecord objectForKey:@"fk_component_id"]
+                                                                date:consumptionDate
+                                                          inDatabase:_database];
+    }
+    if (!success) {
+        NSLog(@"Controller failed to withdraw kit: %@", [_database lastErrorMessage]);
+        [_database rollback];
+        return NO;
+    }
+    NSDictionary<NSNumber *, NSArray *> *stockLevels = [self stockLevelsForExpenditureRecords:expenditureRecords];
+    [_database commit];
+    NSDictionary *kit = @{
+        @"BillOfMaterialsID"  : bomID,
+        @"Builds"             : builds
+    };
+    [self journalKitWithdrawalOfExpenditureRecords:expenditureRecords consumptionDate:consumptionDate kit:kit];
+    [self postKitWithdrawalOfExpenditureRecords:expenditureRecords stockLevels:stockLevels kit:kit reverting:NO];
+    return YES;
+}
+
+
+// Each component's stock and reorder threshold, or NSNull without one, read before the kit's transaction commits
+- (NSDictionary<NSNumber *, NSArray *> *)stockLevelsForExpenditureRecords:(NSArray<NSDictionary *> *)expenditureRecords {
+    NSMutableDictionary<NSNumber *, NSArray *> *stockLevels = [[NSMutableDictionary alloc] initWithCapacity:[expenditureRecords count]];
+    for (NSDictionary *expenditureRecord in expenditureRecords) {
+        NSNumber *componentID = [expenditureRecord objectForKey:@"fk_component_id"];
+        [stockLevels setObject:@[[self stockForComponentID:componentID], FMDB_SQL_NULLABLE([self minimumQuantityForComponentID:componentID])]
+                        forKey:componentID];
+    }
+    return stockLevels;
+}
+
+
+/*
+ A single notification for the whole kit instead of one per line, then a low stock alert for
+ each line the kit moved across its threshold, the same as a single movement posts.
+ */
+- (void)postKitWithdrawalOfExpenditureRecords:(NSArray<NSDictionary *> *)expenditureRecords
+                                  stockLevels:(NSDictionary<NSNumber *, NSArray *> *)stockLevels
+                                          kit:(NSDictionary *)kit
+                                    reverting:(BOOL)reverting {
+    NSMutableDictionary<NSNumber *, NSNumber *> *updatedQuantities = [[NSMutableDictionary alloc] initWithCapacity:[stockLevels count]];
+    for (NSNumber *componentID in stockLevels) {
+        [updatedQuantities setObject:[stockLevels objectForKey:componentID][0] forKey:componentID];
+    }
+    NSMutableDictionary *userInfo = [kit mutableCopy];
+    [userInfo setObject:updatedQuantities forKey:@"UpdatedQuantities"];
+    [[NSNotificationCenter defaultCenter] postNotificationName:@"DBCKitWithdrawnNotification"
+                                                        object:self
+                                                      userInfo:userInfo];
+    for (NSDictionary *expenditureRecord in expenditureRecords) {
+        NSNumber *componentID = [expenditureRecord objectForKey:@"fk_component_id"];
+        NSArray *stockLevel = [stockLevels objectForKey:componentID];
+        NSInteger quantity = [stockLevel[0] integerValue];
+        NSNumber *minimumQuantity = stockLevel[1] != [NSNull null] ? stockLevel[1] : nil;
+        NSInteger withdrawnQuantity = [[expenditureRecord objectForKey:@"quantity"] integerValue];
+        NSInteger previousQuantity = reverting ? quantity - withdrawnQuantity : quantity + withdrawnQuantity;
+        [self postLowStockNotificationForComponentID:componentID
+                                            quantity:quantity
+                                     minimumQuantity:minimumQuantity
+                                     wasBelowMinimum:minimumQuantity && previousQuantity < [minimumQuantity integerValue]];
+    }
+}
+
+
+- (void)postLowStockNotificationForComponentID:(NSNumber *)componentID
+                                      quantity:(NSInteger)quantity
+                               minimumQuantity:(nullable NSNumber *)minimumQuantity
+                               wasBelowMinimum:(BOOL)wasBelowMinimum {
+    // Posted only when a component moves to the other side of its threshold
+    BOOL isBelowMinimum = minimumQuantity && quantity < [minimumQuantity integerValue];
+    if (isBelowMinimum == wasBelowMinimum) {
+        return;
+    }
+    [[NSNotificationCenter defaultCenter] postNotificationName:@"DBCLowStockNotification"
+                                                        object:self
+                                                      userInfo:@{
+                                                          @"ComponentID"        : componentID,
+                                                          @"Quantity"           : [NSNumber numberWithInteger:quantity],
+                                                          @"MinimumQuantity"    : FMDB_SQL_NULLABLE(minimumQuantity),
+                                                          @"BelowMinimum"       : [NSNumber numberWithBool:isBelowMinimum]
+                                                      }];
+}
+
+
+#pragma mark - Undo Journal
+
+/*
+ Each journal entry is the row a movement or registration inserted, kept in memory by the
+ undo manager. Undoing deletes that row by primary key and reverses its effect on stock;
+ redoing inserts the same row again, so entries stay valid for one another whatever the
+ order they're replayed in. Either way it's a handful of statements in one transaction.
+ */
+- (BOOL)insertRecord:(NSDictionary<NSString *, id> *)record intoTable:(NSString *)table {
+    NSArray<NSString *> *columns = [record allKeys];
+    NSString *statement = [NSString stringWithFormat:@"INSERT INTO %@(%@) VALUES (:%@)", table,
+                           [columns componentsJoinedByString:@", "], [columns componentsJoinedByString:@", :"]];
+    return [_database executeUpdate:statement withParameterDictionary:record];
+}
+
+
+- (void)journalMovementRecord:(NSDictionary *)record
+                        table:(NSString *)table
+              consumptionDate:(nullable NSDate *)consumptionDate
+                   actionName:(NSString *)actionName {
+    [_undoManager registerUndoWithTarget:self handler:^(DatabaseController *controller) {
+        [controller applyMovementRecord:record table:table consumptionDate:consumptionDate actionName:actionName reverting:YES];
+    }];
+    [_undoManager setActionName:actionName];
+}
+
+
+- (void)applyMovementRecord:(NSDictionary *)record
+                      table:(NSString *)table
+            consumptionDate:(nullable NSDate *)consumptionDate
+                 actionName:(NSString *)actionName
+                  reverting:(BOOL)reverting {
+    NSNumber *componentID = [record objectForKey:@"fk_component_id"];
+    NSInteger quantity = [[record objectForKey:@"quantity"] integerValue];
+    BOOL isWithdrawal = [table isEqualToString:@"expenditures"];
+    // Stock change when applying the movement; reverting applies its opposite
+    NSInteger stockDelta = (isWithdrawal ? -quantity : quantity) * (reverting ? -1 : 1);
+    [_database beginExclusiveTransaction];
+    BOOL success = NO;
+    if (reverting) {
+        NSString *statement = [NSString stringWithFormat:@"DELETE FROM %@ WHERE id = ?", table];
+        success = [_database executeUpdate:statement, [record objectForKey:@"id"]] && [_database changes] == 1;
+    } else {
+        success = [self insertRecord:record intoTable:table];
+    }
+    success = success && [_database executeUpdate:@"UPDATE stock SET quantity = quantity + ? WHERE component_id = ?", [NSNumber numberWithInteger:stockDelta], componentID];
+    if (success && isWithdrawal) {
+        success = [ConsumptionForecaster recordExpenditureOfQuantity:reverting ? -quantity : quantity
+                                                         componentID:componentID
+                                                                date:consumptionDate
+                                                          inDatabase:_database];
+    }
+    if (!success) {
+        NSLog(@"Controller failed to %@ %@: %@", reverting ? @"undo" : @"redo", [actionName lowercaseString], [_database lastErrorMessage]);
+        [_database rollback];
+        return;
+    }
+    NSNumber *updatedQuantity = [self stockForComponentID:componentID];
+    NSNumber *minimumQuantity = [self minimumQuantityForComponentID:componentID];
     [_database commit];
-    [[NSNotificationCenter defaultCenter] postNotificationName:@"DBCComponentRegisteredNotification"
+    [_undoManager registerUndoWithTarget:self handler:^(DatabaseController *controller) {
+        [controller applyMovementRecord:record table:table consumptionDate:consumptionDate actionName:actionName reverting:!reverting];
+    }];
+    [_undoManager setActionName:actionName];
+    [[NSNotificationCenter defaultCenter] postNotificationName:@"DBCStockUpdatedNotification"
                                                         object:self
                                                       userInfo:@{
-                                                          @"ComponentID"  : newComponentID,
-                                                          @"PartNumber"   : partNumber
+                                                          @"UpdatedComponentID" : componentID,
+                                                          @"UpdatedQuantity"    : updatedQuantity
                                                       }];
+    [self postLowStockNotificationForComponentID:componentID
+                                        quantity:[updatedQuantity integerValue]
+                                 minimumQuantity:minimumQuantity
+                                 wasBelowMinimum:minimumQuantity && [updatedQuantity integerValue] - stockDelta < [minimumQuantity integerValue]];
+}
+
+
+// A kit withdrawal is one entry, undone and redone as a whole
+- (void)journalKitWithdrawalOfExpenditureRecords:(NSArray<NSDictionary *> *)expenditureRecords
+                                 consumptionDate:(NSDate *)consumptionDate
+                                             kit:(NSDictionary *)kit {
+    [_undoManager registerUndoWithTarget:self handler:^(DatabaseController *controller) {
+        [controller applyKitWithdrawalOfExpenditureRecords:expenditureRecords consumptionDate:consumptionDate kit:kit reverting:YES];
+    }];
+    [_undoManager setActionName:@"Kit Withdrawal"];
+}
+
+
+- (void)applyKitWithdrawalOfExpenditureRecords:(NSArray<NSDictionary *> *)expenditureRecords
+                               consumptionDate:(NSDate *)consumptionDate
+                                           kit:(NSDictionary *)kit
+                                     reverting:(BOOL)reverting {
+    [_database beginExclusiveTransaction];
+    BOOL success = YES;
+    for (NSDictionary *expenditureRecord in expenditureRecords) {
+        NSNumber *componentID = [expenditureRecord objectForKey:@"fk_component_id"];
+        NSInteger quantity = [[expenditureRecord objectForKey:@"quantity"] integerValue];
+        if (reverting) {
+            success = [_database executeUpdate:@"DELETE FROM expenditures WHERE id = ?", [expenditureRecord objectForKey:@"id"]] && [_database changes] == 1;
+        } else {
+            success = [self insertRecord:expenditureRecord intoTable:@"expenditures"];
+        }
+        success = success && [_database executeUpdate:@"UPDATE stock SET quantity = quantity + ? WHERE component_id = ?", [NSNumber numberWithInteger:reverting ? quantity : -quantity], componentID]
+                          && [ConsumptionForecaster recordExpenditureOfQuantity:reverting ? -quantity : quantity
+                                                                    componentID:componentID
+                                                                           date:consumptionDate
+                                                                     inDatabase:_database];
+        if (!success) {
+            break;
+        }
+    }
+    if (!success) {
+        NSLog(@"Controller failed to %@ kit withdrawal: %@", reverting ? @"undo" : @"redo", [_database lastErrorMessage]);
+        [_database rollback];
+        return;
+    }
+    NSDictionary<NSNumber *, NSArray *> *stockLevels = [self stockLevelsForExpenditureRecords:expenditureRecords];
+    [_database commit];
+    [_undoManager registerUndoWithTarget:self handler:^(DatabaseController *controller) {
+        [controller applyKitWithdrawalOfExpenditureRecords:expenditureRecords consumptionDate:consumptionDate kit:kit reverting:!reverting];
+    }];
+    [_undoManager setActionName:@"Kit Withdrawal"];
+    [self postKitWithdrawalOfExpenditureRecords:expenditureRecords stockLevels:stockLevels kit:kit reverting:reverting];
+}
+
+
+- (void)journalRegistrationOfComponentRecord:(NSDictionary *)componentRecord
+                           acquisitionRecord:(NSDictionary *)acquisitionRecord {
+    [_undoManager registerUndoWithTarget:self handler:^(DatabaseController *controller) {
+        [controller applyRegistrationOfComponentRecord:componentRecord acquisitionRecord:acquisitionRecord reverting:YES];
+    }];
+    [_undoManager setActionName:@"Registration"];
+}
+
+
+- (void)applyRegistrationOfComponentRecord:(NSDictionary *)componentRecord
+                         acquisitionRecord:(NSDictionary *)acquisitionRecord
+                                 reverting:(BOOL)reverting {
+    NSNumber *componentID = [componentRecord objectForKey:@"component_id"];
+    [_database beginExclusiveTransaction];
+    BOOL success = NO;
+    if (reverting) {
+        // Only the initial acquisition may reference the component, otherwise its history would be orphaned
+        FMResultSet *resultSet = [_database executeQuery:@"SELECT EXISTS(SELECT 1 FROM acquisitions WHERE fk_component_id = ? AND id <> ?) OR EXISTS(SELECT 1 FROM expenditures WHERE fk_component_id = ?) OR EXISTS(SELECT 1 FROM bom_lines WHERE fk_component_id = ?)",
+                                  componentID, [acquisitionRecord objectForKey:@"id"], componentID, componentID];
+        BOOL isReferenced = [resultSet next] && [resultSet boolForColumnIndex:0];
+        [resultSet close];
+        success = !isReferenced
+            && [_database executeUpdate:@"DELETE FROM acquisitions WHERE id = ?", [acquisitionRecord objectForKey:@"id"]]
+            && [_database executeUpdate:@"DELETE FROM stock WHERE component_id = ?", componentID]
+            && [_database changes] == 1;
+    } else {
+        success = [self insertRecord:componentRecord intoTable:@"stock"]
+            && [self insertRecord:acquisitionRecord intoTable:@"acquisitions"];
+    }
+    if (!success) {
+        NSLog(@"Controller failed to %@ registration: %@", reverting ? @"undo" : @"redo", [_database lastErrorMessage]);
+        [_database rollback];
+        return;
+    }
+    [_database commit];
+    [_undoManager registerUndoWithTarget:self handler:^(DatabaseController *controller) {
+        [controller applyRegistrationOfComponentRecord:componentRecord acquisitionRecord:acquisitionRecord reverting:!reverting];
+    }];
+    [_undoManager setActionName:@"Registration"];
+    if (reverting) {
+        [[NSNotificationCenter defaultCenter] postNotificationName:@"DBCComponentRemovedNotification"
+                                                            object:self
+                                                          userInfo:@{ @"ComponentID" : componentID }];
+    } else {
+        [[NSNotificationCenter defaultCenter] postNotificationName:@"DBCComponentRegisteredNotification"
+                                                            object:self
+                                                          userInfo:@{
+                                                              @"ComponentID"  : componentID,
+                                                              @"PartNumber"   : [componentRecord objectForKey:@"part_number"]
+                                                          }];
+    }
+}
+
+#pragma mark - Backup
+
+- (nullable DatabaseBackup *)backUpDatabaseToPath:(NSString *)path
+                                  progressHandler:(nullable DatabaseBackupProgressHandler)progressHandler
+                                completionHandler:(nullable DatabaseBackupCompletionHandler)completionHandler {
+    if (![_database isOpen]) {
+        return nil;
+    }
+    if (_backup && ![_backup isFinished]) {
+        NSLog(@"Controller is already backing up to '%@'.", [_backup destinationPath]);
+        return nil;
+    }
+    NSString *sourcePath = [_database databasePath];
+    [self setBackup:[[DatabaseBackup alloc] initWithDatabase:_database destinationPath:path]];
+    [_backup startWithProgressHandler:progressHandler completionHandler:^(BOOL success) {
+        if (completionHandler) {
+            completionHandler(success);
+        }
+        [[NSNotificationCenter defaultCenter] postNotificationName:@"DBCBackupFinishedNotification"
+                                                            object:self
+                                                          userInfo:@{
+                                                              @"SourcePath" : sourcePath,
+                                                              @"DestinationPath" : path,
+                                                              @"Success" : [NSNumber numberWithBool:success]
+                                                          }];
+    }];
+    return _backup;
+}
+
+
+- (void)scheduleBackupsToDirectory:(nullable NSString *)directory interval:(NSTimeInterval)interval {
+    if (_backupTimer) {
+        dispatch_source_cancel(_backupTimer);
+        [self setBackupTimer:nil];
+    }
+    if ([directory length] == 0 || interval <= 0.0) {
+        return;
+    }
+    [self setBackupTimer:dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue())];
+    uint64_t intervalNanoseconds = (uint64_t)(interval * NSEC_PER_SEC);
+    dispatch_source_set_timer(_backupTimer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)intervalNanoseconds), intervalNanoseconds, intervalNanoseconds / 10);
+    __weak DatabaseController *weakSelf = self;
+    dispatch_source_set_event_handler(_backupTimer, ^{
+        [weakSelf performScheduledBackupToDirectory:directory];
+    });
+    dispatch_resume(_backupTimer);
+}
+
+
+- (void)performScheduledBackupToDirectory:(NSString *)directory {
+    if (![_database isOpen]) {
+        return;
+    }
+    // Timestamped names sort chronologically, which is what pruning relies on
+    NSString *prefix = [[[_database databasePath] lastPathComponent] stringByDeletingPathExtension];
+    NSDateFormatter *formatter = [[NSDateFormatter alloc] init];
+    [formatter setLocale:[NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"]];
+    [formatter setDateFormat:@"yyyy-MM-dd HHmmss"];
+    NSString *fileName = [NSString stringWithFormat:@"%@ %@.sqlite", prefix, [formatter stringFromDate:[NSDate date]]];
+    [self backUpDatabaseToPath:[directory stringByAppendingPathComponent:fileName] progressHandler:nil completionHandler:^(BOOL success) {
+        if (success) {
+            [DatabaseController pruneBackupsWithPrefix:prefix inDirectory:directory];
+        }
+    }];
+}
+
+
++ (void)pruneBackupsWithPrefix:(NSString *)prefix inDirectory:(NSString *)directory {
+    NSArray<NSString *> *fileNames = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:directory error:nil];
+    NSPredicate *predicate = [NSPredicate predicateWithFormat:@"SELF BEGINSWITH %@ AND SELF ENDSWITH '.sqlite'", [prefix stringByAppendingString:@" "]];
+    NSArray<NSString *> *backups = [[fileNames filteredArrayUsingPredicate:predicate] sortedArrayUsingSelector:@selector(compare:)];
+    for (NSUInteger i = 0; i + BACKUP_RETENTION_COUNT < [backups count]; i++) {
+        [[NSFileManager defaultManager] removeItemAtPath:[directory stringByAppendingPathComponent:backups[i]] error:nil];
+    }
+}
+
+
+/*
+ The backup steps through the connection, so a running one must end before the connection closes.
+ Cancelling only takes effect between steps, so the close is left to the backup's queue rather than
+ waited for here.
+ */
+- (void)closeConnection {
+    FMDatabase *database = _database;
+    DatabaseBackup *backup = _backup;
+    [self setBackup:nil];
+    if (backup && ![backup isFinished]) {
+        [backup cancelWithCompletionHandler:^{
+            [database close];
+        }];
+    } else {
+        [database close];
+    }
+}
+
+#pragma mark - Maintenance
+
+/*
+ Commits report the write-ahead log's size here. Registering the hook turns off SQLite's automatic
+ checkpoint, which would otherwise run inside whichever commit crosses 1000 frames; checkpoints
+ are left to idle time unless the log grows past WAL_CHECKPOINT_LIMIT.
+ */
+static int walCommitHook(void *context, sqlite3 *handle, const char *databaseName, int frameCount) {
+    DatabaseController *controller = (__bridge DatabaseController *)context;
+    [controller setWalFrameCount:frameCount];
+    if (frameCount >= WAL_CHECKPOINT_LIMIT) {
+        sqlite3_wal_checkpoint_v2(handle, databaseName, SQLITE_CHECKPOINT_PASSIVE, NULL, NULL);
+    }
+    return SQLITE_OK;
+}
+
+
+- (void)startMaintenance {
+    sqlite3 *handle = [_database sqliteHandle];
+    sqlite3_wal_hook(handle, walCommitHook, (__bridge void *)self);
+    [self setObservedTotalChanges:sqlite3_total_changes(handle)];
+    [self setAnalyzedTotalChanges:_observedTotalChanges];
+    [self setLastWriteTime:CFAbsoluteTimeGetCurrent()];
+    [self setWalFrameCount:0];
+    [self setMaintenanceTimer:dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue())];
+    uint64_t interval = (uint64_t)(MAINTENANCE_POLL_INTERVAL * NSEC_PER_SEC);
+    dispatch_source_set_timer(_maintenanceTimer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)interval), interval, interval / 10);
+    __weak DatabaseController *weakSelf = self;
+    dispatch_source_set_event_handler(_maintenanceTimer, ^{
+        [weakSelf maintenanceTimerFired];
+    });
+    dispatch_resume(_maintenanceTimer);
+}
+
+
+- (void)stopMaintenance {
+    if (_maintenanceTimer) {
+        dispatch_source_cancel(_maintenanceTimer);
+        [self setMaintenanceTimer:nil];
+    }
+    [self setPendingAnalyzeTargets:nil];
+    [self setMaintenanceInProgress:NO];
+    if ([_database isOpen]) {
+        // Analyzes only what the session's queries showed would benefit, usually nothing
+        [_database executeStatements:@"PRAGMA optimize;"];
+        sqlite3_wal_hook([_database sqliteHandle], NULL, NULL);
+    }
+}
+
+
+- (void)maintenanceTimerFired {
+    // Any row changed since the last poll means the user is still working
+    int totalChanges = sqlite3_total_changes([_database sqliteHandle]);
+    if (totalChanges != _observedTotalChanges) {
+        [self setObservedTotalChanges:totalChanges];
+        [self setLastWriteTime:CFAbsoluteTimeGetCurrent()];
+        return;
+    }
+    if (_maintenanceInProgress || CFAbsoluteTimeGetCurrent() - _lastWriteTime < MAINTENANCE_IDLE_DELAY) {
+        return;
+    }
+    if (!_pendingAnalyzeTargets && totalChanges - _analyzedTotalChanges >= ANALYZE_CHANGE_THRESHOLD) {
+        [self setPendingAnalyzeTargets:[self analyzeTargets]];
+        [self setAnalyzedTotalChanges:totalChanges];
+    }
+    [self setMaintenanceInProgress:YES];
+    [self performMaintenanceSlice];
+}
+
+
+- (NSMutableArray<NSString *> *)analyzeTargets {
+    // Indexes are analyzed one at a time so a large import's statistics are gathered in slices
+    NSMutableArray<NSString *> *targets = [[NSMutableArray alloc] init];
+    FMResultSet *resultSet = [_database executeQuery:@"SELECT name FROM sqlite_master WHERE type = 'index' AND name NOT LIKE 'sqlite_autoindex_%' ORDER BY tbl_name"];
+    while ([resultSet next]) {
+        [targets addObject:[resultSet stringForColumnIndex:0]];
+    }
+    [resultSet close];
+    return targets;
+}
+
+
+/*
+ Runs maintenance steps until the time budget is spent, then yields the main queue and continues
+ in another slice. A step is the smallest unit SQLite offers: one index for ANALYZE, a few pages of
+ incremental vacuum, or a passive checkpoint, which never takes the write lock.
+ */
+- (void)performMaintenanceSlice {
+    if (!_maintenanceInProgress || ![_database isOpen]) {
+        return;
+    }
+    if (sqlite3_total_changes([_database sqliteHandle]) != _observedTotalChanges) {
+        // A write arrived; stop and wait for the next idle period
+        [self setMaintenanceInProgress:NO];
+        return;
+    }
+    CFAbsoluteTime deadline = CFAbsoluteTimeGetCurrent() + _maintenanceTimeBudget;
+    BOOL hasMoreWork = YES;
+    while (hasMoreWork && CFAbsoluteTimeGetCurrent() < deadline) {
+        hasMoreWork = [self performMaintenanceStep];
+    }
+    // Maintenance writes count as changes too, but not as user activity
+    [self setObservedTotalChanges:sqlite3_total_changes([_database sqliteHandle])];
+    if (!hasMoreWork) {
+        [self setMaintenanceInProgress:NO];
+        return;
+    }
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(MAINTENANCE_SLICE_DELAY * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [self performMaintenanceSlice];
+    });
+}
+
+
+- (BOOL)performMaintenanceStep {
+    if ([_pendingAnalyzeTargets count] > 0) {
+        NSString *target = [_pendingAnalyzeTargets firstObject];
+        [_pendingAnalyzeTargets removeObjectAtIndex:0];
+        if (![_database executeStatements:[NSString stringWithFormat:@"ANALYZE \"%@\";", target]]) {
+            NSLog(@"Controller failed to analyze '%@': %@", target, [_database lastErrorMessage]);
+        }
+        return YES;
+    }
+    [self setPendingAnalyzeTargets:nil];
+    // Free pages are only released in place when the file uses incremental auto-vacuum
+    if ([_database intForQuery:@"PRAGMA auto_vacuum"] == 2 && [_database intForQuery:@"PRAGMA freelist_count"] > 0) {
+        if (![_database executeStatements:[NSString stringWithFormat:@"PRAGMA incremental_vacuum(%d);", INCREMENTAL_VACUUM_PAGES]]) {
+            NSLog(@"Controller failed to vacuum: %@", [_database lastErrorMessage]);
+            return NO;
+        }
+        return YES;
+    }
+    if (_walFrameCount >= WAL_CHECKPOINT_THRESHOLD) {
+        // Frames still needed by readers in other processes are left for a later checkpoint
+        sqlite3_wal_checkpoint_v2([_database sqliteHandle], "main", SQLITE_CHECKPOINT_PASSIVE, NULL, NULL);
+        [self setWalFrameCount:0];
+    }
+    return NO;
+}
+
+#pragma mark - Startup Metadata
+
+/*
+ Reads what the main window needs beyond its cached startup snapshot on a separate read-only
+ connection, so the window can draw from the snapshot while this runs.
+ */
++ (void)loadStartupMetadataForDatabaseAtPath:(NSString *)path
+                           completionHandler:(DatabaseMetadataCompletionHandler)completionHandler {
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        DatabaseController *probe = [[DatabaseController alloc] init];
+        NSDictionary *metadata = nil;
+        if ([probe openProbeAtPath:path storageProfile:DatabaseStorageProfileBalanced writable:NO]) {
+            metadata = @{
+                @"component_type_summaries" : [probe componentTypeSummaries],
+                @"below_minimum_count" : [NSNumber numberWithUnsignedInteger:[probe countOfComponentsBelowMinimumQuantity]],
+                @"nullable_columns" : [[probe nullableColumnsOfTable:@"stock"] allObjects]
+            };
+            [probe closeProbe];
+        }
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completionHandler(metadata);
+        });
+    });
+}
+
+#pragma mark - Storage Benchmark
+
+/*
+ Times the main window's searches and history queries, followed by stock movements committed one
+ at a time, under each profile's durability and cache settings. The reads alone can't tell the
+ profiles apart beyond their caches, so the movements are what weigh full sync against a
+ write-ahead log. A separate controller runs them on a background queue against a scratch copy
+ of the file, reconnecting per profile so each starts with an empty page cache, after one
+ warm-up pass has loaded the file into the OS cache.
+ */
++ (void)benchmarkStorageProfilesForDatabaseAtPath:(NSString *)path
+                                completionHandler:(DatabaseBenchmarkCompletionHandler)completionHandler {
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        DatabaseController *probe = [[DatabaseController alloc] init];
+        NSMutableDictionary<NSNumber *, NSNumber *> *timings = [[NSMutableDictionary alloc] init];
+        NSString *scratchPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+        NSDictionary *workload = nil;
+        if ([probe openProbeAtPath:path storageProfile:DatabaseStorageProfileDurable writable:NO]) {
+            workload = [probe benchmarkWorkload];
+            [probe runBenchmarkWorkload:workload];
+            if (![probe copyProbeToPath:scratchPath]) {
+                workload = nil;
+            }
+            [probe closeProbe];
+        }
+        DatabaseStorageProfile profiles[] = {
+            DatabaseStorageProfileDurable,
+            DatabaseStorageProfileBalanced,
+            DatabaseStorageProfileReadOptimized
+        };
+        DatabaseStorageProfile recommendedProfile = DatabaseStorageProfileDurable;
+        for (size_t i = 0; workload && i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+            CFTimeInterval fastestTime = DBL_MAX;
+            for (NSUInteger repetition = 0; repetition < BENCHMARK_REPETITIONS; repetition++) {
+                if (![probe openProbeAtPath:scratchPath storageProfile:profiles[i] writable:YES]) {
+                    break;
+                }
+                CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+                [probe runBenchmarkWorkload:workload];
+                [probe runBenchmarkMovements:workload];
+                fastestTime = MIN(fastestTime, CFAbsoluteTimeGetCurrent() - startTime);
+                [probe closeProbe];
+            }
+            [timings setObject:[NSNumber numberWithDouble:fastestTime] forKey:[NSNumber numberWithInteger:profiles[i]]];
+            // Profiles are listed most durable first, so a later one has to be clearly faster
+            if (fastestTime < [[timings objectForKey:[NSNumber numberWithInteger:recommendedProfile]] doubleValue] * BENCHMARK_SIGNIFICANT_SPEEDUP) {
+                recommendedProfile = profiles[i];
+            }
+        }
+        NSFileManager *fileManager = [NSFileManager defaultManager];
+        for (NSString *suffix in @[@"", @"-wal", @"-shm", @"-journal"]) {
+            [fileManager removeItemAtPath:[scratchPath stringByAppendingString:suffix] error:nil];
+        }
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completionHandler([timings copy], recommendedProfile);
+        });
+    });
+}
+
+
+// A writable probe also takes the profile's durability settings, for timing commits
+- (BOOL)openProbeAtPath:(NSString *)path storageProfile:(DatabaseStorageProfile)profile writable:(BOOL)writable {
+    [self setDatabase:[FMDatabase databaseWithPath:path]];
+    if (![_database openWithFlags:writable ? SQLITE_OPEN_READWRITE : SQLITE_OPEN_READONLY]) {
+        NSLog(@"Benchmark failed to open database file '%@'.", path);
+        return NO;
+    }
+    [_database setDateFormat:_dateFormatter];
+    [_database setShouldCacheStatements:YES];
+    [self enableCaseSensitiveLike];
+    // Listings order and filter through these functions and name lookup ids through the caches, as on the main connection
+    if (![self registerNaturalOrder] || ![self registerEngineeringFunctions]) {
+        [_database close];
+        return NO;
+    }
+    if (writable) {
+        [_database executeStatements:[DatabaseController durabilityPragmasForStorageProfile:profile]];
+    }
+    [_database executeStatements:[DatabaseController cachePragmasForStorageProfile:profile]];
+    [self setComponentTypeCache:[[LookupTableCache alloc] initWithDatabase:_database table:@"component_types"]];
+    [self setManufacturerCache:[[LookupTableCache alloc] initWithDatabase:_database table:@"manufacturers"]];
+    [self setPackageCodeCache:[[LookupTableCache alloc] initWithDatabase:_database table:@"package_codes"]];
+    return YES;
+}
+
+
+// Copied with a rollback journal, so the durable profile that runs first is timed without a write-ahead log
+- (BOOL)copyProbeToPath:(NSString *)path {
+    FMDatabase *scratch = [FMDatabase databaseWithPath:path];
+    if (![scratch open]) {
+        NSLog(@"Benchmark failed to create scratch file '%@'.", path);
+        return NO;
+    }
+    sqlite3_backup *backup = sqlite3_backup_init([scratch sqliteHandle], "main", [_database sqliteHandle], "main");
+    BOOL success = backup && sqlite3_backup_step(backup, -1) == SQLITE_DONE;
+    sqlite3_backup_finish(backup);
+    success = success && [scratch executeStatements:@"PRAGMA journal_mode = DELETE;"];
+    if (!success) {
+        NSLog(@"Benchmark failed to copy the database: %@", [scratch lastErrorMessage]);
+    }
+    [scratch close];
+    return success;
+}
+
+
+- (void)closeProbe {
+    [self setComponentTypeCache:nil];
+    [self setManufacturerCache:nil];
+    [self setPackageCodeCache:nil];
+    [_database close];
+    [self setDatabase:nil];
+}
+
+
+- (NSDictionary *)benchmarkWorkload {
+    NSMutableArray<NSString *> *prefixes = [[NSMutableArray alloc] init];
+    NSMutableArray<NSNumber *> *componentIDs = [[NSMutableArray alloc] init];
+    FMResultSet *resultSet = [_database executeQuery:@"SELECT component_id, part_number FROM stock ORDER BY random() LIMIT ?",
+                              [NSNumber numberWithInt:BENCHMARK_SAMPLE_SIZE]];
+    while ([resultSet next]) {
+        [componentIDs addObject:[NSNumber numberWithInteger:[resultSet longForColumnIndex:0]]];
+        NSString *partNumber = [resultSet stringForColumnIndex:1];
+        // Two characters is about where typing in the search field starts returning short lists
+        [prefixes addObject:[partNumber substringToIndex:MIN([partNumber length], 2)]];
+    }
+    [resultSet close];
+    return @{
+        @"prefixes" : prefixes,
+        @"component_types" : [self componentTypes],
+        @"component_ids" : componentIDs
+    };
+}
+
+
+- (void)runBenchmarkWorkload:(NSDictionary *)workload {
+    for (NSString *prefix in [workload objectForKey:@"prefixes"]) {
+        [self incrementalSearchResultsForPartNumber:prefix sortDescriptors:@[]];
+    }
+    for (NSString *type in [workload objectForKey:@"component_types"]) {
+        [self searchResultsForComponentType:type sortDescriptors:@[]];
+    }
+    for (NSNumber *componentID in [workload objectForKey:@"component_ids"]) {
+        [self stockReplenishmentsForComponentID:componentID];
+        [self stockWithdrawalsForComponentID:componentID];
+    }
+}
+
+
+- (void)runBenchmarkMovements:(NSDictionary *)workload {
+    // One transaction per movement as in the app, each undone by the next so the copy stays as it was
+    for (NSNumber *componentID in [workload objectForKey:@"component_ids"]) {
+        for (NSInteger delta = 1; delta >= -1; delta -= 2) {
+            [_database beginExclusiveTransaction];
+            [_database executeUpdate:@"UPDATE stock SET quantity = quantity + ? WHERE component_id = ?", [NSNumber numberWithInteger:delta], componentID];
+            [_database commit];
+        }
+    }
 }
 
+#pragma mark -
 
 + (NSDate *)dateWithClearedTimeComponentsFromDate:(NSDate *)date {
     NSCalendar *calendar = [NSCalendar calendarWithIdentifier:NSCalendarIdentifierISO8601];
@@ -0,0 +1,29 @@
+//
+//  LookupTableCache.h
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+@class FMDatabase;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ Names of a lookup table (component_types, manufacturers or package_codes) by id and back.
+ Lookup rows are never deleted, so once committed an id names the same value for good and the
+ cache is never invalidated. Each name is held once and shared by every row decoded with it.
+ A miss reloads the whole table, which holds only distinct values; misses inside a transaction
+ are answered from the database without caching, as the row may yet be rolled back.
+ */
+@interface LookupTableCache : NSObject
+
+- (instancetype)initWithDatabase:(FMDatabase *)database table:(NSString *)table;
+- (nullable NSString *)nameForID:(int64_t)identifier;
+- (nullable NSNumber *)identifierForName:(NSString *)name;
+
+@end
+
+NS_ASSUME_NONNULL_END
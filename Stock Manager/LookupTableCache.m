@@ -0,0 +1,95 @@
+//
+//  LookupTableCache.m
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import "LookupTableCache.h"
+#import "FMDB.h"
+
+@interface LookupTableCache ()
+
+@property FMDatabase *database;
+@property NSString *table;
+@property NSMutableDictionary<NSString *, NSNumber *> *identifiers;
+
+@end
+
+@implementation LookupTableCache {
+    CFMutableDictionaryRef _names; //Id stored as a plain integer to its name
+}
+
+- (instancetype)initWithDatabase:(FMDatabase *)database table:(NSString *)table {
+    self = [super init];
+    if (self) {
+        _database = database;
+        _table = table;
+        _identifiers = [[NSMutableDictionary alloc] init];
+        _names = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, NULL, &kCFTypeDictionaryValueCallBacks);
+    }
+    return self;
+}
+
+
+- (void)dealloc {
+    CFRelease(_names);
+}
+
+
+- (BOOL)reload {
+    if ([_database isInTransaction]) {
+        return NO;
+    }
+    NSString *query = [NSString stringWithFormat:@"SELECT id, name FROM %@", _table];
+    FMResultSet *resultSet = [_database executeQuery:query];
+    while ([resultSet next]) {
+        int64_t identifier = [resultSet longLongIntForColumnIndex:0];
+        if (!CFDictionaryContainsKey(_names, (const void *)(intptr_t)identifier)) {
+            NSString *name = [resultSet stringForColumnIndex:1];
+            CFDictionarySetValue(_names, (const void *)(intptr_t)identifier, (__bridge const void *)name);
+            [_identifiers setObject:[NSNumber numberWithLongLong:identifier] forKey:name];
+        }
+    }
+    [resultSet close];
+    return YES;
+}
+
+
+- (nullable NSString *)nameForID:(int64_t)identifier {
+    NSString *name = (__bridge NSString *)CFDictionaryGetValue(_names, (const void *)(intptr_t)identifier);
+    if (name) {
+        return name;
+    }
+    if ([self reload]) {
+        return (__bridge NSString *)CFDictionaryGetValue(_names, (const void *)(intptr_t)identifier);
+    }
+    NSString *query = [NSString stringWithFormat:@"SELECT name FROM %@ WHERE id = ?", _table];
+    FMResultSet *resultSet = [_database executeQuery:query, [NSNumber numberWithLongLong:identifier]];
+    if ([resultSet next]) {
+        name = [resultSet stringForColumnIndex:0];
+    }
+    [resultSet close];
+    return name;
+}
+
+
+- (nullable NSNumber *)identifierForName:(NSString *)name {
+    NSNumber *identifier = [_identifiers objectForKey:name];
+    if (identifier) {
+        return identifier;
+    }
+    if ([self reload]) {
+        return [_identifiers objectForKey:name];
+    }
+    NSString *query = [NSString stringWithFormat:@"SELECT id FROM %@ WHERE name = ?", _table];
+    FMResultSet *resultSet = [_database executeQuery:query, name];
+    if ([resultSet next]) {
+        identifier = [NSNumber numberWithLongLong:[resultSet longLongIntForColumnIndex:0]];
+    }
+    [resultSet close];
+    return identifier;
+}
+
+@end
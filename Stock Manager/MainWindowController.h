@@ -11,9 +11,10 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
-@interface MainWindowController : NSWindowController <NSControlTextEditingDelegate, NSTableViewDataSource, NSTableViewDelegate>
+@interface MainWindowController : NSWindowController <NSWindowDelegate, NSControlTextEditingDelegate, NSTableViewDataSource, NSTableViewDelegate>
 
 - (void)closeWindows;
+- (void)saveStartupSnapshot;
 
 @end
 
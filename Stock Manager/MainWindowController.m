@@ -9,11 +9,19 @@
 #import "MainWindowController.h"
 #import "DatabaseController.h"
 #import "ComponentRating.h"
+#import "SearchResultSorter.h"
 #import "RegistrationWindowController.h"
 #import "StockIncrementViewController.h"
 #import "StockDecrementViewController.h"
 
 #define TABLE_CELL_LATERAL_SPACING 2.0
+#define BELOW_MINIMUM_MENU_ITEM_TAG 1
+#define RUNNING_OUT_MENU_ITEM_TAG 2
+#define NEAREST_VALUE_COUNT 3 //Values listed when a searched rating isn't stocked
+#define SUBSTITUTE_COUNT 20
+#define KIT_ACCESSORY_WIDTH 240.0
+#define COMBINATION_TOLERANCE 1.0 //Percent
+#define COMBINATION_COUNT 10
 
 @interface MainWindowController ()
 
@@ -37,6 +45,9 @@
 @property NSMutableArray *stockWithdrawals;
 @property NSDateFormatter *dateFormatter;
 @property NSNumber *selectedComponentID;
+@property NSArray<NSDictionary *> *componentTypeSummaries;
+@property NSUInteger belowMinimumCount;
+@property NSSet<NSString *> *nullableColumns;
 
 @end
 
@@ -56,15 +67,25 @@
 
 - (void)windowDidLoad {
     [super windowDidLoad];
-    NSArray *componentTypes = [[DatabaseController sharedController] componentTypes];
-    [_componentTypeSelectionButton addItemsWithTitles:componentTypes];
-    // Hide nullable columns from search results
+    [[self window] setDelegate:self];
+    // Draw from the snapshot saved at the last quit and reconcile with the database once its metadata arrives
+    BOOL restoredSnapshot = [self restoreStartupSnapshot];
+    if (!restoredSnapshot) {
+        [self loadMetadata];
+    }
+    [self rebuildComponentTypeMenu];
     for (NSTableColumn *column in [_searchResultsTableView tableColumns]) {
-        if ([[DatabaseController sharedController] isNullableColumn:[column identifier] table:@"stock"]) {
+        if ([self isOptionalColumn:[column identifier]]) {
             [column setHidden:YES];
         }
     }
     [_searchResultsTableView sizeToFit];
+    if (restoredSnapshot) {
+        NSString *dbFilePath = [[NSUserDefaults standardUserDefaults] stringForKey:@"kDBFileLocation"];
+        [DatabaseController loadStartupMetadataForDatabaseAtPath:dbFilePath completionHandler:^(NSDictionary *metadata) {
+            [self reconcileStartupMetadata:metadata];
+        }];
+    }
     [[NSNotificationCenter defaultCenter] addObserver:self
                                              selector:@selector(stockUpdatedNotification:)
                                                  name:@"DBCStockUpdatedNotification"
@@ -73,6 +94,18 @@
                                              selector:@selector(componentRegisteredNotification:)
                                                  name:@"DBCComponentRegisteredNotification"
                                                object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(lowStockNotification:)
+                                                 name:@"DBCLowStockNotification"
+                                               object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(kitWithdrawnNotification:)
+                                                 name:@"DBCKitWithdrawnNotification"
+                                               object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(componentRemovedNotification:)
+                                                 name:@"DBCComponentRemovedNotification"
+                                               object:nil];
 }
 
 
@@ -84,24 +117,75 @@
 
 - (IBAction)partNumberSearchFieldEdited:(id)sender {
     NSString *partNumber = [[self partNumberSearchTerm] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
-    if ([partNumber length] > 0) {
-        [self setSearchResults:[[DatabaseController sharedController] incrementalSearchResultsForPartNumber:partNumber]];
-    } else {
+    if ([partNumber length] == 0) {
         [self setPartNumberSearchTerm:@""];
         [self setSearchResults:nil];
+        [self updateSearchResultsTable];
+        return;
     }
+    NSMutableArray<NSMutableDictionary *> *searchResults = [[DatabaseController sharedController] incrementalSearchResultsForPartNumber:partNumber
+                                                                                                              sortDescriptors:[_searchResultsTableView sortDescriptors]];
+    ComponentRatingParseResult rating;
+    if ([searchResults count] == 0 && [ComponentRating parseString:partNumber result:&rating]
+        && (rating.hasMultiplier || rating.kind != ComponentRatingKindUnknown)) {
+        // No part number starts so; notation such as "4k7" or "100nF" then searches ratings
+        searchResults = [[DatabaseController sharedController] searchResultsForRatingValue:rating.value kind:rating.kind];
+        if ([searchResults count] == 0) {
+            // Nothing of that exact value; list what's in stock closest to it instead
+            NSArray<NSDictionary *> *nearestValues = [[DatabaseController sharedController] nearestStockedValuesTo:rating.value
+                                                                                                              kind:rating.kind
+                                                                                                             count:NEAREST_VALUE_COUNT
+                                                                                                           filters:@{}];
+            for (NSDictionary *nearestValue in nearestValues) {
+                [searchResults addObjectsFromArray:[nearestValue objectForKey:@"components"]];
+            }
+        }
+    }
+    [self setSearchResults:searchResults];
     [self updateSearchResultsTable];
 }
 
 - (IBAction)componentTypePopupSelected:(id)sender {
     [_partNumberSearchField abortEditing];
     [self setPartNumberSearchTerm:@""];
-    NSString *componentType = [_componentTypeSelectionButton titleOfSelectedItem];
-    [self setSearchResults:[[DatabaseController sharedController] searchResultsForComponentType:componentType]];
+    NSMenuItem *selectedItem = [_componentTypeSelectionButton selectedItem];
+    if ([selectedItem tag] == BELOW_MINIMUM_MENU_ITEM_TAG) {
+        [self setSearchResults:[[DatabaseController sharedController] searchResultsBelowMinimumQuantity]];
+    } else if ([selectedItem tag] == RUNNING_OUT_MENU_ITEM_TAG) {
+        [_searchResultsTableView setSortDescriptors:@[]]; //Listed in forecast order
+        [self setSearchResults:[[DatabaseController sharedController] searchResultsRunningOutSoonest]];
+    } else {
+        NSString *componentType = [selectedItem representedObject];
+        [self setSearchResults:[[DatabaseController sharedController] searchResultsForComponentType:componentType
+                                                                                    sortDescriptors:[_searchResultsTableView sortDescriptors]]];
+    }
     [self updateSearchResultsTable];
 }
 
 
+- (IBAction)minimumQuantityEdited:(NSTextField *)sender {
+    NSInteger row = [_searchResultsTableView rowForView:sender];
+    if (row < 0) {
+        return;
+    }
+    NSMutableDictionary *searchResult = _searchResults[row];
+    NSString *input = [[sender stringValue] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    NSNumber *minimumQuantity = [input length] > 0 ? [NSNumber numberWithInteger:MAX([input integerValue], 0)] : nil;
+    NSNumber *previousMinimumQuantity = [searchResult objectForKey:@"min_quantity"];
+    if (minimumQuantity == previousMinimumQuantity || [minimumQuantity isEqual:previousMinimumQuantity]) {
+        return;
+    }
+    if (minimumQuantity) {
+        [searchResult setObject:minimumQuantity forKey:@"min_quantity"];
+        [sender setStringValue:[minimumQuantity stringValue]];
+    } else {
+        [searchResult removeObjectForKey:@"min_quantity"];
+    }
+    [[DatabaseController sharedController] setMinimumQuantity:minimumQuantity
+                                               forComponentID:[searchResult objectForKey:@"component_id"]];
+}
+
+
 - (IBAction)stockActionsSegmentedControlClicked:(id)sender {
     NSInteger selectedSegmentIndex = [_stockActionsSegmentedControl selectedSegment];
     if (selectedSegmentIndex == 0) {
@@ -156,13 +240,203 @@
 }
 
 
+- (IBAction)findSubstitutesMenuItemClicked:(id)sender {
+    if (!_selectedComponentID) {
+        return;
+    }
+    NSMutableArray<NSMutableDictionary *> *searchResults = [[DatabaseController sharedController] substitutesForComponentID:_selectedComponentID
+                                                                                                                       limit:SUBSTITUTE_COUNT];
+    // The original stays listed first and selected, so each substitute's ratings can be compared against it
+    for (NSMutableDictionary *searchResult in _searchResults) {
+        if ([searchResult[@"component_id"] isEqualToNumber:_selectedComponentID]) {
+            [searchResults insertObject:searchResult atIndex:0];
+            break;
+        }
+    }
+    [_partNumberSearchField abortEditing];
+    [self setPartNumberSearchTerm:@""];
+    [_searchResultsTableView setSortDescriptors:@[]]; //Listed closest first
+    [self setSearchResults:searchResults];
+    [self updateSearchResultsTable];
+}
+
+
+- (IBAction)findCombinationsMenuItemClicked:(id)sender {
+    NSTextField *targetTextField = [NSTextField textFieldWithString:@""];
+    [targetTextField setPlaceholderString:@"4k7, 3.3nF"];
+    NSPopUpButton *kindPopUpButton = [[NSPopUpButton alloc] initWithFrame:NSMakeRect(0.0, 0.0, KIT_ACCESSORY_WIDTH, 26.0) pullsDown:NO];
+    for (NSNumber *kind in @[@(ComponentRatingKindResistance), @(ComponentRatingKindCapacitance)]) {
+        [kindPopUpButton addItemWithTitle:[ComponentRating ratingNames][[kind integerValue]]];
+        [[kindPopUpButton lastItem] setTag:[kind integerValue]];
+    }
+    NSButton *triplesCheckbox = [NSButton checkboxWithTitle:@"Include three-part networks" target:nil action:nil];
+    NSGridView *gridView = [NSGridView gridViewWithViews:@[
+        @[[NSTextField labelWithString:@"Value:"], targetTextField],
+        @[[NSTextField labelWithString:@"Rating:"], kindPopUpButton],
+        @[[NSGridCell emptyContentView], triplesCheckbox]
+    ]];
+    [[gridView columnAtIndex:0] setXPlacement:NSGridCellPlacementTrailing];
+    [gridView setFrameSize:[gridView fittingSize]];
+    NSAlert *alert = [[NSAlert alloc] init];
+    [alert setAlertStyle:NSAlertStyleInformational];
+    [alert setMessageText:@"Find Combinations"];
+    [alert setInformativeText:@"Looks for stocked parts that make the value in series or in parallel."];
+    [alert setAccessoryView:gridView];
+    [alert addButtonWithTitle:@"Find"];
+    [alert addButtonWithTitle:@"Cancel"];
+    [[alert window] setInitialFirstResponder:targetTextField];
+    if ([alert runModal] != NSAlertFirstButtonReturn) {
+        return;
+    }
+    ComponentRatingParseResult rating;
+    if (![ComponentRating parseString:[targetTextField stringValue] result:&rating] || rating.value <= 0.0) {
+        return;
+    }
+    // A written unit picks the rating; the pop-up only settles bare values
+    ComponentRatingKind kind = rating.kind != ComponentRatingKindUnknown ? rating.kind : [[kindPopUpButton selectedItem] tag];
+    NSArray<NSDictionary *> *networks = [[DatabaseController sharedController] combinationsForTarget:rating.value
+                                                                                                kind:kind
+                                                                                           tolerance:COMBINATION_TOLERANCE
+                                                                                     includesTriples:[triplesCheckbox state] == NSControlStateValueOn
+                                                                                               limit:COMBINATION_COUNT];
+    NSMutableArray<NSString *> *lines = [[NSMutableArray alloc] initWithCapacity:[networks count]];
+    for (NSDictionary *network in networks) {
+        NSArray<NSString *> *partValues = [[network objectForKey:@"values"] valueForKey:@"engineeringValue"];
+        [lines addObject:[NSString stringWithFormat:@"%@ in %@: %@ (%+.2f%%)",
+                          [partValues componentsJoinedByString:@" + "],
+                          [network objectForKey:@"topology"],
+                          [[network objectForKey:@"value"] engineeringValue],
+                          [[network objectForKey:@"deviation"] doubleValue]]];
+    }
+    NSAlert *resultAlert = [[NSAlert alloc] init];
+    [resultAlert setAlertStyle:NSAlertStyleInformational];
+    if ([lines count]) {
+        [resultAlert setMessageText:@"Stocked Combinations"];
+        [resultAlert setInformativeText:[lines componentsJoinedByString:@"\n"]];
+    } else {
+        [resultAlert setMessageText:@"No stocked combination is close enough."];
+        [resultAlert setInformativeText:[NSString stringWithFormat:@"Nothing in stock makes the value within %g%%.", COMBINATION_TOLERANCE]];
+    }
+    [resultAlert runModal];
+}
+
+
+- (IBAction)addToKitMenuItemClicked:(id)sender {
+    if (!_selectedComponentID) {
+        return;
+    }
+    NSComboBox *kitComboBox = [[NSComboBox alloc] initWithFrame:NSMakeRect(0.0, 0.0, KIT_ACCESSORY_WIDTH, 26.0)];
+    for (NSDictionary *kit in [[DatabaseController sharedController] billsOfMaterials]) {
+        [kitComboBox addItemWithObjectValue:kit[@"name"]];
+    }
+    NSTextField *quantityTextField = [self kitQuantityTextField];
+    NSAlert *alert = [[NSAlert alloc] init];
+    [alert setAlertStyle:NSAlertStyleInformational];
+    [alert setMessageText:@"Add the Selected Component to a Kit"];
+    [alert setInformativeText:@"Pick a kit or name a new one, and the units each build uses."];
+    [alert setAccessoryView:[self kitAccessoryViewWithKitControl:kitComboBox quantityLabel:@"Units per build:" quantityTextField:quantityTextField]];
+    [alert addButtonWithTitle:@"Add"];
+    [alert addButtonWithTitle:@"Cancel"];
+    [[alert window] setInitialFirstResponder:kitComboBox];
+    if ([alert runModal] != NSAlertFirstButtonReturn) {
+        return;
+    }
+    NSString *kitName = [[kitComboBox stringValue] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    NSInteger quantity = [quantityTextField integerValue];
+    if (![kitName length] || quantity < 1) {
+        return;
+    }
+    [[DatabaseController sharedController] setQuantity:[NSNumber numberWithInteger:quantity]
+                                        forComponentID:_selectedComponentID
+                                inBillOfMaterialsNamed:kitName];
+}
+
+
+- (IBAction)withdrawKitMenuItemClicked:(id)sender {
+    NSArray<NSDictionary *> *kits = [[DatabaseController sharedController] billsOfMaterials];
+    if (![kits count]) {
+        return;
+    }
+    NSPopUpButton *kitPopUpButton = [[NSPopUpButton alloc] initWithFrame:NSMakeRect(0.0, 0.0, KIT_ACCESSORY_WIDTH, 26.0) pullsDown:NO];
+    for (NSDictionary *kit in kits) {
+        NSUInteger buildableCount = [[DatabaseController sharedController] buildableCountForBillOfMaterialsID:kit[@"id"]];
+        [kitPopUpButton addItemWithTitle:[NSString stringWithFormat:@"%@ (%lu buildable)", kit[@"name"], (unsigned long)buildableCount]];
+        [[kitPopUpButton lastItem] setRepresentedObject:kit];
+    }
+    NSTextField *buildsTextField = [self kitQuantityTextField];
+    NSAlert *alert = [[NSAlert alloc] init];
+    [alert setAlertStyle:NSAlertStyleInformational];
+    [alert setMessageText:@"Withdraw a Kit"];
+    [alert setInformativeText:@"Every component of the kit is withdrawn from stock in one go."];
+    [alert setAccessoryView:[self kitAccessoryViewWithKitControl:kitPopUpButton quantityLabel:@"Builds:" quantityTextField:buildsTextField]];
+    [alert addButtonWithTitle:@"Withdraw"];
+    [alert addButtonWithTitle:@"Cancel"];
+    if ([alert runModal] != NSAlertFirstButtonReturn) {
+        return;
+    }
+    NSDictionary *kit = [[kitPopUpButton selectedItem] representedObject];
+    NSInteger builds = [buildsTextField integerValue];
+    if (builds < 1) {
+        return;
+    }
+    NSDictionary *parameters = @{
+        @"bom_id"       : kit[@"id"],
+        @"builds"       : [NSNumber numberWithInteger:builds],
+        @"date_spent"   : [DatabaseController dateWithClearedTimeComponentsFromDate:[NSDate date]],
+        @"destination"  : kit[@"name"]
+    };
+    if (![[DatabaseController sharedController] kitWithdrawalWithParameters:parameters]) {
+        NSAlert *failureAlert = [[NSAlert alloc] init];
+        [failureAlert setAlertStyle:NSAlertStyleWarning];
+        [failureAlert setMessageText:@"Could not withdraw the kit."];
+        [failureAlert setInformativeText:[NSString stringWithFormat:@"There isn't enough stock for %ld builds of '%@'.", (long)builds, kit[@"name"]]];
+        [failureAlert runModal];
+    }
+}
+
+
+- (NSTextField *)kitQuantityTextField {
+    NSNumberFormatter *formatter = [[NSNumberFormatter alloc] init];
+    [formatter setMinimum:@1];
+    [formatter setAllowsFloats:NO];
+    NSTextField *textField = [NSTextField textFieldWithString:@"1"];
+    [textField setFormatter:formatter];
+    return textField;
+}
+
+
+- (NSView *)kitAccessoryViewWithKitControl:(NSControl *)kitControl
+                             quantityLabel:(NSString *)quantityLabel
+                         quantityTextField:(NSTextField *)quantityTextField {
+    NSGridView *gridView = [NSGridView gridViewWithViews:@[
+        @[[NSTextField labelWithString:@"Kit:"], kitControl],
+        @[[NSTextField labelWithString:quantityLabel], quantityTextField]
+    ]];
+    [[gridView columnAtIndex:0] setXPlacement:NSGridCellPlacementTrailing];
+    [gridView setFrameSize:[gridView fittingSize]];
+    return gridView;
+}
+
+
+- (BOOL)validateMenuItem:(NSMenuItem *)menuItem {
+    if ([menuItem action] == @selector(findSubstitutesMenuItemClicked:) || [menuItem action] == @selector(addToKitMenuItemClicked:)) {
+        return _selectedComponentID != nil;
+    }
+    if ([menuItem action] == @selector(withdrawKitMenuItemClicked:)) {
+        return [[[DatabaseController sharedController] billsOfMaterials] count] > 0;
+    }
+    return YES;
+}
+
+
 - (void)updateSearchResultsTable {
-    [_searchResultsTableView setSortDescriptors:@[]];
+    // Listings keep the sort the user chose; SQL ordered ones are only checked
+    [SearchResultSorter sortResults:_searchResults usingDescriptors:[_searchResultsTableView sortDescriptors] nullsFirst:NO];
     [_searchResultsTableView reloadData];
     // Hide entirely empty non-essential columns
     for (NSTableColumn *column in [_searchResultsTableView tableColumns]) {
         NSString *columnID = [column identifier];
-        if ([[DatabaseController sharedController] isNullableColumn:columnID table:@"stock"]) {
+        if ([self isOptionalColumn:columnID]) {
             [column setHidden:YES];
             for (NSDictionary *result in _searchResults) {
                 id value = result[columnID];
@@ -196,6 +470,152 @@
 }
 
 
+- (BOOL)isOptionalColumn:(NSString *)columnID {
+    // Nullable and forecast columns show only when filled, except for the reorder threshold which is edited in place
+    return ([_nullableColumns containsObject:columnID] && ![columnID isEqualToString:@"min_quantity"])
+        || [columnID isEqualToString:@"days_remaining"];
+}
+
+
+- (void)loadMetadata {
+    [self setComponentTypeSummaries:[[DatabaseController sharedController] componentTypeSummaries]];
+    [self setBelowMinimumCount:[[DatabaseController sharedController] countOfComponentsBelowMinimumQuantity]];
+    [self setNullableColumns:[[DatabaseController sharedController] nullableColumnsOfTable:@"stock"]];
+}
+
+
+- (BOOL)restoreStartupSnapshot {
+    NSDictionary *snapshot = [[NSUserDefaults standardUserDefaults] dictionaryForKey:@"kStartupSnapshot"];
+    NSString *dbFilePath = [[NSUserDefaults standardUserDefaults] stringForKey:@"kDBFileLocation"];
+    if (![[snapshot objectForKey:@"database_path"] isEqual:dbFilePath]) {
+        return NO; //First launch, or the snapshot describes another file
+    }
+    [self setComponentTypeSummaries:[snapshot objectForKey:@"component_type_summaries"]];
+    [self setBelowMinimumCount:[[snapshot objectForKey:@"below_minimum_count"] unsignedIntegerValue]];
+    [self setNullableColumns:[NSSet setWithArray:[snapshot objectForKey:@"nullable_columns"]]];
+    [self setPartNumberSearchTerm:[snapshot objectForKey:@"part_number_search_term"] ?: @""];
+    [self setSelectedComponentID:[snapshot objectForKey:@"selected_component_id"]];
+    return YES;
+}
+
+
+- (void)saveStartupSnapshot {
+    NSString *dbFilePath = [[NSUserDefaults standardUserDefaults] stringForKey:@"kDBFileLocation"];
+    if (!_componentTypeSummaries || !_nullableColumns || !dbFilePath) {
+        return;
+    }
+    NSMenuItem *selectedItem = [_componentTypeSelectionButton selectedItem];
+    NSMutableDictionary *snapshot = [@{
+        @"database_path" : dbFilePath,
+        @"component_type_summaries" : _componentTypeSummaries,
+        @"below_minimum_count" : [NSNumber numberWithUnsignedInteger:_belowMinimumCount],
+        @"nullable_columns" : [_nullableColumns allObjects],
+        @"part_number_search_term" : [self partNumberSearchTerm] ?: @"",
+        @"selected_menu_item_tag" : [NSNumber numberWithInteger:[selectedItem tag]]
+    } mutableCopy];
+    if ([selectedItem representedObject]) {
+        [snapshot setObject:[selectedItem representedObject] forKey:@"selected_component_type"];
+    }
+    if (_selectedComponentID) {
+        [snapshot setObject:_selectedComponentID forKey:@"selected_component_id"];
+    }
+    [[NSUserDefaults standardUserDefaults] setObject:snapshot forKey:@"kStartupSnapshot"];
+}
+
+
+- (void)reconcileStartupMetadata:(nullable NSDictionary *)metadata {
+    if (metadata) {
+        [self setComponentTypeSummaries:[metadata objectForKey:@"component_type_summaries"]];
+        [self setBelowMinimumCount:[[metadata objectForKey:@"below_minimum_count"] unsignedIntegerValue]];
+        [self setNullableColumns:[NSSet setWithArray:[metadata objectForKey:@"nullable_columns"]]];
+    } else {
+        [self loadMetadata];
+    }
+    [self rebuildComponentTypeMenu];
+    [self repeatRestoredSearch];
+}
+
+
+- (void)repeatRestoredSearch {
+    // The snapshot holds the search, not its results, which may have changed since
+    NSDictionary *snapshot = [[NSUserDefaults standardUserDefaults] dictionaryForKey:@"kStartupSnapshot"];
+    NSInteger selectedTag = [[snapshot objectForKey:@"selected_menu_item_tag"] integerValue];
+    NSString *selectedType = [snapshot objectForKey:@"selected_component_type"];
+    NSInteger selectedIndex = selectedType ? [_componentTypeSelectionButton indexOfItemWithRepresentedObject:selectedType]
+                                           : (selectedTag > 0 ? [_componentTypeSelectionButton indexOfItemWithTag:selectedTag] : -1);
+    if (selectedIndex > 1) {
+        [_componentTypeSelectionButton selectItemAtIndex:selectedIndex];
+        [self componentTypePopupSelected:nil];
+    } else if ([[self partNumberSearchTerm] length] > 0) {
+        [self partNumberSearchFieldEdited:nil];
+    } else {
+        [self updateSearchResultsTable];
+    }
+}
+
+
+- (void)reloadComponentTypeMenu {
+    [self setComponentTypeSummaries:[[DatabaseController sharedController] componentTypeSummaries]];
+    [self setBelowMinimumCount:[[DatabaseController sharedController] countOfComponentsBelowMinimumQuantity]];
+    [self rebuildComponentTypeMenu];
+}
+
+
+/*
+ Reloads the menu once the current run loop pass is over, so a burst of stock movements, as from
+ the service or a batch of edits, queries the type totals and alert count only once.
+ */
+- (void)setNeedsComponentTypeMenuReload {
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(reloadComponentTypeMenu) object:nil];
+    [self performSelector:@selector(reloadComponentTypeMenu) withObject:nil afterDelay:0];
+}
+
+
+- (void)rebuildComponentTypeMenu {
+    // Past the placeholder and separator come the alert and forecast lists, then each type with its size as the title and the type itself as the represented object
+    NSMenuItem *selectedItem = [_componentTypeSelectionButton selectedItem];
+    NSString *selectedType = [selectedItem representedObject];
+    for (NSInteger i = [_componentTypeSelectionButton numberOfItems] - 1; i > 1; i--) {
+        [_componentTypeSelectionButton removeItemAtIndex:i];
+    }
+    NSMenu *menu = [_componentTypeSelectionButton menu];
+    NSMenuItem *belowMinimumItem = [[NSMenuItem alloc] initWithTitle:[NSString stringWithFormat:@"Below Minimum Stock (%lu)", _belowMinimumCount]
+                                                              action:nil
+                                                       keyEquivalent:@""];
+    [belowMinimumItem setTag:BELOW_MINIMUM_MENU_ITEM_TAG];
+    [belowMinimumItem setToolTip:@"Components whose stock fell under their reorder threshold."];
+    [menu addItem:belowMinimumItem];
+    if ([selectedItem tag] == BELOW_MINIMUM_MENU_ITEM_TAG) {
+        [_componentTypeSelectionButton selectItem:belowMinimumItem];
+    }
+    NSMenuItem *runningOutItem = [[NSMenuItem alloc] initWithTitle:@"Running Out Soonest"
+                                                            action:nil
+                                                     keyEquivalent:@""];
+    [runningOutItem setTag:RUNNING_OUT_MENU_ITEM_TAG];
+    [runningOutItem setToolTip:@"Consumed components ordered by the days their stock lasts at the recent usage rate."];
+    [menu addItem:runningOutItem];
+    if ([selectedItem tag] == RUNNING_OUT_MENU_ITEM_TAG) {
+        [_componentTypeSelectionButton selectItem:runningOutItem];
+    }
+    [menu addItem:[NSMenuItem separatorItem]];
+    for (NSDictionary *summary in _componentTypeSummaries) {
+        NSString *componentType = [summary objectForKey:@"component_type"];
+        NSInteger componentCount = [[summary objectForKey:@"component_count"] integerValue];
+        NSInteger totalQuantity = [[summary objectForKey:@"total_quantity"] integerValue];
+        NSMenuItem *menuItem = [[NSMenuItem alloc] initWithTitle:[NSString stringWithFormat:@"%@ (%ld)", componentType, componentCount]
+                                                          action:nil
+                                                   keyEquivalent:@""];
+        [menuItem setRepresentedObject:componentType];
+        [menuItem setToolTip:[NSString stringWithFormat:@"%ld part number%@, %ld unit%@ in stock.",
+                              componentCount, componentCount == 1 ? @"" : @"s", totalQuantity, totalQuantity == 1 ? @"" : @"s"]];
+        [menu addItem:menuItem];
+        if ([componentType isEqualToString:selectedType]) {
+            [_componentTypeSelectionButton selectItem:menuItem];
+        }
+    }
+}
+
+
 - (void)disableSelectedStockControls {
     [_stockActionsSegmentedControl setEnabled:NO forSegment:0];
     [_stockActionsSegmentedControl setEnabled:NO forSegment:1];
@@ -212,6 +632,13 @@
     return bounds;
 }
 
+#pragma mark - NSWindowDelegate
+
+- (NSUndoManager *)windowWillReturnUndoManager:(NSWindow *)window {
+    // Undo and redo apply to the stock movements journaled by the database controller
+    return [[DatabaseController sharedController] undoManager];
+}
+
 #pragma mark - NSControlTextEditingDelegate
 
 -(void)controlTextDidBeginEditing:(NSNotification *)obj {
@@ -247,6 +674,16 @@
             cellView = [tableView makeViewWithIdentifier:columnID owner:self];
             NSTextField *textField = [cellView textField];
             [textField setIntegerValue:[(NSNumber *)value integerValue]];
+        } else if ([columnID isEqualToString:@"min_quantity"]) {
+            cellView = [tableView makeViewWithIdentifier:columnID owner:self];
+            NSTextField *textField = [cellView textField];
+            [textField setStringValue:value ? [(NSNumber *)value stringValue] : @""];
+        } else if ([columnID isEqualToString:@"days_remaining"]) {
+            if (value) {
+                cellView = [tableView makeViewWithIdentifier:columnID owner:self];
+                NSTextField *textField = [cellView textField];
+                [textField setStringValue:[NSString stringWithFormat:@"%.0f", floor([(NSNumber *)value doubleValue])]];
+            }
         } else if ([columnID isEqualToString:@"part_number"]) {
             cellView = [tableView makeViewWithIdentifier:columnID owner:self];
             NSTextField *textField = [cellView textField];
@@ -368,7 +805,7 @@
 - (void)tableView:(NSTableView *)tableView sortDescriptorsDidChange:(NSArray<NSSortDescriptor *> *)oldDescriptors {
     // Search results table
     NSArray<NSSortDescriptor *> *sortDescriptors = [_searchResultsTableView sortDescriptors];
-    [_searchResults sortUsingDescriptors:sortDescriptors];
+    [SearchResultSorter sortResults:_searchResults usingDescriptors:sortDescriptors nullsFirst:NO]; //Blank cells at the bottom either way
     [_searchResultsTableView reloadData];
     [self reassertSearchResultSelection];
 }
@@ -408,7 +845,7 @@
 
 - (void)stockUpdatedNotification:(NSNotification *)notification {
     NSNumber *updatedComponentID = [[notification userInfo] objectForKey:@"UpdatedComponentID"];
-    NSNumber *updatedQuantity = [[DatabaseController sharedController] stockForComponentID:updatedComponentID];
+    NSNumber *updatedQuantity = [[notification userInfo] objectForKey:@"UpdatedQuantity"];
     for (NSMutableDictionary *searchResult in _searchResults) {
         NSNumber *componentID = searchResult[@"component_id"];
         if ([componentID isEqualToNumber:updatedComponentID]) {
@@ -417,22 +854,68 @@
             break;
         }
     }
+    [self setNeedsComponentTypeMenuReload]; //Unit totals changed
+    if ([[_componentTypeSelectionButton selectedItem] tag] == RUNNING_OUT_MENU_ITEM_TAG) {
+        // Withdrawals change consumption rates and so the forecast order
+        [self setSearchResults:[[DatabaseController sharedController] searchResultsRunningOutSoonest]];
+        [self updateSearchResultsTable];
+    }
 }
 
 
-- (void)componentRegisteredNotification:(NSNotification *)notification {
-    NSArray *componentTypes = [[DatabaseController sharedController] componentTypes];
-    for (NSInteger i = [_componentTypeSelectionButton numberOfItems] - 1; i > 1; i--) {
-        [_componentTypeSelectionButton removeItemAtIndex:i];
+- (void)kitWithdrawnNotification:(NSNotification *)notification {
+    NSDictionary<NSNumber *, NSNumber *> *updatedQuantities = [[notification userInfo] objectForKey:@"UpdatedQuantities"];
+    NSInteger selectedTag = [[_componentTypeSelectionButton selectedItem] tag];
+    [self setNeedsComponentTypeMenuReload];
+    if (selectedTag == BELOW_MINIMUM_MENU_ITEM_TAG) {
+        [self setSearchResults:[[DatabaseController sharedController] searchResultsBelowMinimumQuantity]];
+    } else if (selectedTag == RUNNING_OUT_MENU_ITEM_TAG) {
+        [self setSearchResults:[[DatabaseController sharedController] searchResultsRunningOutSoonest]];
+    } else {
+        for (NSMutableDictionary *searchResult in _searchResults) {
+            NSNumber *updatedQuantity = [updatedQuantities objectForKey:searchResult[@"component_id"]];
+            if (updatedQuantity) {
+                [searchResult setObject:updatedQuantity forKey:@"quantity"];
+            }
+        }
+    }
+    [self updateSearchResultsTable]; //Once for the whole kit
+}
+
+
+- (void)componentRemovedNotification:(NSNotification *)notification {
+    NSNumber *removedComponentID = [[notification userInfo] objectForKey:@"ComponentID"];
+    [self setNeedsComponentTypeMenuReload];
+    for (NSMutableDictionary *searchResult in _searchResults) {
+        if ([searchResult[@"component_id"] isEqualToNumber:removedComponentID]) {
+            [_searchResults removeObject:searchResult];
+            [self updateSearchResultsTable];
+            break;
+        }
     }
-    [_componentTypeSelectionButton addItemsWithTitles:componentTypes];
+}
+
+
+- (void)lowStockNotification:(NSNotification *)notification {
+    [self setNeedsComponentTypeMenuReload];
+    if ([[_componentTypeSelectionButton selectedItem] tag] == BELOW_MINIMUM_MENU_ITEM_TAG) {
+        // Only the alerts are read back, not the catalog
+        [self setSearchResults:[[DatabaseController sharedController] searchResultsBelowMinimumQuantity]];
+        [self updateSearchResultsTable];
+    }
+}
+
+
+- (void)componentRegisteredNotification:(NSNotification *)notification {
+    [self setNeedsComponentTypeMenuReload];
     NSString *partNumber = [[notification userInfo] objectForKey:@"PartNumber"];
     if (![[self window] isVisible]) {
         [self showWindow:nil];
     }
     [_partNumberSearchField abortEditing];
     [self setPartNumberSearchTerm:partNumber];
-    [self setSearchResults:[[DatabaseController sharedController] incrementalSearchResultsForPartNumber:partNumber]];
+    [self setSearchResults:[[DatabaseController sharedController] incrementalSearchResultsForPartNumber:partNumber
+                                                                                 sortDescriptors:[_searchResultsTableView sortDescriptors]]];
     [self updateSearchResultsTable];
 }
 
@@ -0,0 +1,35 @@
+//
+//  NaturalOrder.h
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ Natural order of part numbers: runs of digits compare by their value, so "R2" goes before "R10",
+ and anything else byte by byte as SQLite's BINARY collation does. Leading zeros don't count, so
+ "R02" and "R2" are equal. Compares UTF-8 text without allocating.
+ */
+int NaturalOrderCompare(const char *first, size_t firstLength, const char *second, size_t secondLength);
+
+/*
+ Writes a key whose byte order is the natural order of the text: each digit run becomes a marker
+ of its length followed by its significant digits, so keys of texts sharing a prefix without
+ trailing digits share that prefix's key. The key takes at most twice the length of the text.
+ Returns its length.
+ */
+size_t NaturalOrderSortKey(const char *text, size_t length, char *key);
+
+@interface NSString (NaturalOrder)
+
+- (NSComparisonResult)naturalCompare:(NSString *)string;
+- (NSString *)naturalSortKey;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,103 @@
+//
+//  NaturalOrder.m
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import "NaturalOrder.h"
+
+#define MARKER_RUN_LENGTH 9 //Longest run one marker byte can tell; longer runs repeat the '9' marker
+
+typedef struct {
+    const unsigned char *bytes;
+    size_t length;
+    size_t position;
+    size_t runEnd;          //End of the digit run being read out
+    ptrdiff_t markerLength; //Significant digits still to be told by markers, or -1 once told
+} KeyCursor;
+
+
+static BOOL isDigit(unsigned char byte) {
+    return byte >= '0' && byte <= '9';
+}
+
+
+// Next byte of the text's sort key, or -1 past its end
+static int nextKeyByte(KeyCursor *cursor) {
+    if (cursor->markerLength >= MARKER_RUN_LENGTH) {
+        cursor->markerLength -= MARKER_RUN_LENGTH;
+        return '9';
+    } else if (cursor->markerLength >= 0) {
+        int marker = '0' + (int)cursor->markerLength;
+        cursor->markerLength = -1;
+        return marker;
+    }
+    if (cursor->position == cursor->length) {
+        return -1;
+    }
+    unsigned char byte = cursor->bytes[cursor->position];
+    if (cursor->position < cursor->runEnd || !isDigit(byte)) {
+        cursor->position++;
+        return byte;
+    }
+    // A digit run starts: its leading zeros are dropped and its length told first
+    size_t start = cursor->position;
+    while (start < cursor->length && cursor->bytes[start] == '0') {
+        start++;
+    }
+    size_t end = start;
+    while (end < cursor->length && isDigit(cursor->bytes[end])) {
+        end++;
+    }
+    cursor->position = start;
+    cursor->runEnd = end;
+    cursor->markerLength = (ptrdiff_t)(end - start);
+    return nextKeyByte(cursor);
+}
+
+
+int NaturalOrderCompare(const char *first, size_t firstLength, const char *second, size_t secondLength) {
+    KeyCursor firstCursor = { (const unsigned char *)first, firstLength, 0, 0, -1 };
+    KeyCursor secondCursor = { (const unsigned char *)second, secondLength, 0, 0, -1 };
+    while (YES) {
+        int firstByte = nextKeyByte(&firstCursor);
+        int secondByte = nextKeyByte(&secondCursor);
+        if (firstByte != secondByte) {
+            return firstByte < secondByte ? -1 : 1;
+        } else if (firstByte < 0) {
+            return 0;
+        }
+    }
+}
+
+
+size_t NaturalOrderSortKey(const char *text, size_t length, char *key) {
+    KeyCursor cursor = { (const unsigned char *)text, length, 0, 0, -1 };
+    size_t keyLength = 0;
+    int byte;
+    while ((byte = nextKeyByte(&cursor)) >= 0) {
+        key[keyLength++] = (char)byte;
+    }
+    return keyLength;
+}
+
+@implementation NSString (NaturalOrder)
+
+- (NSComparisonResult)naturalCompare:(NSString *)string {
+    const char *first = [self UTF8String];
+    const char *second = [string UTF8String];
+    return (NSComparisonResult)NaturalOrderCompare(first, strlen(first), second, strlen(second));
+}
+
+
+- (NSString *)naturalSortKey {
+    const char *text = [self UTF8String];
+    size_t length = strlen(text);
+    NSMutableData *key = [NSMutableData dataWithLength:2 * length];
+    size_t keyLength = NaturalOrderSortKey(text, length, [key mutableBytes]);
+    return [[NSString alloc] initWithBytes:[key bytes] length:keyLength encoding:NSUTF8StringEncoding];
+}
+
+@end
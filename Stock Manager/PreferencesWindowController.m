@@ -7,6 +7,15 @@
 //
 
 #import "PreferencesWindowController.h"
+#import "DatabaseController.h"
+
+@interface PreferencesWindowController ()
+
+@property (weak) IBOutlet NSPopUpButton *storageProfileButton;
+@property (weak) IBOutlet NSButton *benchmarkButton;
+@property (weak) IBOutlet NSTextField *benchmarkResultLabel;
+
+@end
 
 @implementation PreferencesWindowController
 
@@ -18,7 +27,7 @@
 
 - (void)windowDidLoad {
     [super windowDidLoad];
-    [[self window] setContentMaxSize:NSMakeSize(FLT_MAX, 100.0)];
+    [[self window] setContentMaxSize:NSMakeSize(FLT_MAX, 152.0)];
 }
 
 
@@ -37,4 +46,33 @@
     }
 }
 
+
+- (IBAction)storageProfileSelected:(NSPopUpButton *)sender {
+    // The popup's selected tag is bound to kStorageProfile; this applies it to the open database
+    [[DatabaseController sharedController] setStorageProfile:[sender selectedTag]];
+}
+
+
+- (IBAction)benchmarkButtonClicked:(id)sender {
+    NSString *filePath = [[NSUserDefaults standardUserDefaults] stringForKey:@"kDBFileLocation"];
+    [_benchmarkButton setEnabled:NO];
+    [_benchmarkResultLabel setStringValue:@"Running searches, history queries and stock movements..."];
+    [DatabaseController benchmarkStorageProfilesForDatabaseAtPath:filePath completionHandler:^(NSDictionary<NSNumber *, NSNumber *> *timings, DatabaseStorageProfile recommendedProfile) {
+        [self->_benchmarkButton setEnabled:YES];
+        if ([timings count] == 0) {
+            [self->_benchmarkResultLabel setStringValue:@"The benchmark could not read the database file."];
+            return;
+        }
+        NSMutableArray<NSString *> *results = [[NSMutableArray alloc] init];
+        for (NSMenuItem *item in [self->_storageProfileButton itemArray]) {
+            NSNumber *time = [timings objectForKey:[NSNumber numberWithInteger:[item tag]]];
+            if (time) {
+                [results addObject:[NSString stringWithFormat:@"%@ %.0f ms", [item title], [time doubleValue] * 1000.0]];
+            }
+        }
+        NSString *recommendation = [[self->_storageProfileButton itemAtIndex:[self->_storageProfileButton indexOfItemWithTag:recommendedProfile]] title];
+        [self->_benchmarkResultLabel setStringValue:[NSString stringWithFormat:@"%@. Recommended: %@.", [results componentsJoinedByString:@", "], recommendation]];
+    }];
+}
+
 @end
@@ -11,9 +11,9 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
-@interface RegistrationWindowController : NSWindowController <NSTextFieldDelegate, NSTableViewDataSource, NSTabViewDelegate>
+@interface RegistrationWindowController : NSWindowController <NSWindowDelegate, NSTextFieldDelegate, NSComboBoxDelegate, NSTableViewDataSource, NSTabViewDelegate>
 
-@property NSString *partNumber;
+@property (nonatomic) NSString *partNumber;
 
 - (void)clearInputForm;
 
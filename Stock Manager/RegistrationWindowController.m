@@ -9,9 +9,11 @@
 #import "RegistrationWindowController.h"
 #import "DatabaseController.h"
 #import "ComponentRating.h"
+#import "CompletionIndex.h"
 
 @interface RegistrationWindowController ()
 
+@property (weak) IBOutlet NSTextField *partNumberTextField;
 @property (weak) IBOutlet NSComboBox *manufacturerComboBox;
 @property (weak) IBOutlet NSComboBox *componentTypeComboBox;
 @property (weak) IBOutlet NSComboBox *packageCodeComboBox;
@@ -33,6 +35,9 @@
 @property NSMutableArray<ComponentRating *> *componentRatings;
 @property BOOL stockUpdateModeOn;
 @property NSNumber *preexistingComponentID;
+@property CompletionIndex *manufacturerCompletions;
+@property CompletionIndex *componentTypeCompletions;
+@property CompletionIndex *packageCodeCompletions;
 
 @end
 
@@ -50,16 +55,16 @@
 
 - (void)windowDidLoad {
     [super windowDidLoad];
-    NSArray *componentTypes = [[DatabaseController sharedController] componentTypes];
-    [_componentTypeComboBox addItemsWithObjectValues:componentTypes];
-    NSArray *manufacturers = [[DatabaseController sharedController] manufacturers];
-    [_manufacturerComboBox addItemsWithObjectValues:manufacturers];
-    NSArray *packageCodes = [[DatabaseController sharedController] packageCodes];
-    [_packageCodeComboBox addItemsWithObjectValues:packageCodes];
+    [[self window] setDelegate:self];
+    [_manufacturerComboBox setUsesDataSource:YES];
+    [_componentTypeComboBox setUsesDataSource:YES];
+    [_packageCodeComboBox setUsesDataSource:YES];
+    [self reloadCompletionIndexes];
     [_quantityStepper setMaxValue:FLT_MAX];
     [self buildRatingsMenu];
     [self loadPersistedInput];
     [self clearInputFieldsKeepManufacturer:NO];
+    [self updateSimilarPartNumberWarning];
     [[NSNotificationCenter defaultCenter] addObserver:self
                                              selector:@selector(popUpButtonWillPopUpNotification:)
                                                  name:@"NSPopUpButtonWillPopUpNotification"
@@ -68,6 +73,16 @@
                                              selector:@selector(componentRegisteredNotification:)
                                                  name:@"DBCComponentRegisteredNotification"
                                                object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(componentRemovedNotification:)
+                                                 name:@"DBCComponentRemovedNotification"
+                                               object:nil];
+}
+
+
+- (void)setPartNumber:(NSString *)partNumber {
+    _partNumber = partNumber;
+    [self updateSimilarPartNumberWarning];
 }
 
 
@@ -88,9 +103,16 @@
                                                                               row:selectedRow
                                                                   makeIfNecessary:NO];
     NSTextField *textField = [selectedValueView textField];
-    double newSignificand = [textField doubleValue];
+    ComponentRatingParseResult parsed;
     NSInteger magnitude = [rating orderOfMagnitude];
-    [rating setValue: newSignificand * pow(10.0, magnitude)];
+    if ([ComponentRating parseString:[textField stringValue] result:&parsed]
+        && (parsed.kind == ComponentRatingKindUnknown || [rating isKindOfClass:[ComponentRating ratingClassForKind:parsed.kind]])) {
+        // Notation such as "4k7" or "100nF" carries its own prefix, a bare number keeps the selected one
+        [rating setValue:parsed.hasMultiplier ? parsed.value : parsed.value * pow(10.0, magnitude)];
+    } else {
+        double newSignificand = [textField doubleValue];
+        [rating setValue: newSignificand * pow(10.0, magnitude)];
+    }
     // Synchronize display with generated value
     [textField setDoubleValue:[[rating significand] doubleValue]];
     NSPopUpButton *popUpButton = [selectedValueView popUpButton];
@@ -351,6 +373,50 @@
 }
 
 
+- (void)updateSimilarPartNumberWarning {
+    // Flag records whose part number only differs in case or punctuation from the one being registered
+    NSString *manufacturer = [[_manufacturerComboBox stringValue] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    NSMutableArray<NSString *> *similarDescriptions = [[NSMutableArray alloc] init];
+    if ([_partNumber length] > 0) {
+        NSArray *similarRecords = [[DatabaseController sharedController] similarRecordsForPartNumber:_partNumber];
+        for (NSDictionary *record in similarRecords) {
+            NSString *recordPartNumber = [record objectForKey:@"part_number"];
+            NSString *recordManufacturer = [record objectForKey:@"manufacturer"] ?: @"";
+            if ([recordPartNumber isEqualToString:_partNumber] && [recordManufacturer isEqualToString:manufacturer]) {
+                continue; //Exact match is reported when the manufacturer is entered
+            }
+            if ([recordManufacturer length] > 0) {
+                [similarDescriptions addObject:[NSString stringWithFormat:@"%@ (%@)", recordPartNumber, recordManufacturer]];
+            } else {
+                [similarDescriptions addObject:recordPartNumber];
+            }
+        }
+    }
+    if ([similarDescriptions count] > 0) {
+        [_partNumberTextField setTextColor:[NSColor systemOrangeColor]];
+        [_partNumberTextField setToolTip:[NSString stringWithFormat:@"Similar parts already on the database: %@.", [similarDescriptions componentsJoinedByString:@", "]]];
+    } else {
+        [_partNumberTextField setTextColor:[NSColor labelColor]];
+        [_partNumberTextField setToolTip:nil];
+    }
+}
+
+
+- (void)reloadCompletionIndexes {
+    // Combo boxes query their items on demand, ranked completions come from the usage counts
+    DatabaseController *databaseController = [DatabaseController sharedController];
+    [self setManufacturerCompletions:[[CompletionIndex alloc] initWithUsageCounts:[databaseController manufacturerUsageCounts]]];
+    [_manufacturerComboBox setDataSource:_manufacturerCompletions];
+    [_manufacturerComboBox reloadData];
+    [self setComponentTypeCompletions:[[CompletionIndex alloc] initWithUsageCounts:[databaseController componentTypeUsageCounts]]];
+    [_componentTypeComboBox setDataSource:_componentTypeCompletions];
+    [_componentTypeComboBox reloadData];
+    [self setPackageCodeCompletions:[[CompletionIndex alloc] initWithUsageCounts:[databaseController packageCodeUsageCounts]]];
+    [_packageCodeComboBox setDataSource:_packageCodeCompletions];
+    [_packageCodeComboBox reloadData];
+}
+
+
 - (void)showRatingsOnRecord:(NSDictionary *)record {
     [_componentRatings removeAllObjects];
     ComponentRating *rating = [record objectForKey:@"voltage_rating"];
@@ -449,9 +515,19 @@
     [self clearInputFieldsKeepManufacturer:NO];
 }
 
+#pragma mark - NSWindowDelegate
+
+- (NSUndoManager *)windowWillReturnUndoManager:(NSWindow *)window {
+    return [[DatabaseController sharedController] undoManager];
+}
+
 #pragma mark - NSTextFieldDelegate
 
 -(void)controlTextDidChange:(NSNotification *)obj {
+    if ([obj object] == _manufacturerComboBox) {
+        [self updateSimilarPartNumberWarning];
+        return;
+    }
     // Quantity text field
     int quantity = [_quantityTextField intValue];
     [_quantityStepper setIntValue:quantity];
@@ -504,15 +580,12 @@
 
 
 - (void)componentRegisteredNotification:(NSNotification *)notification {
-    NSArray *componentTypes = [[DatabaseController sharedController] componentTypes];
-    [_componentTypeComboBox removeAllItems];
-    [_componentTypeComboBox addItemsWithObjectValues:componentTypes];
-    NSArray *manufacturers = [[DatabaseController sharedController] manufacturers];
-    [_manufacturerComboBox removeAllItems];
-    [_manufacturerComboBox addItemsWithObjectValues:manufacturers];
-    NSArray *packageCodes = [[DatabaseController sharedController] packageCodes];
-    [_packageCodeComboBox removeAllItems];
-    [_packageCodeComboBox addItemsWithObjectValues:packageCodes];
+    [self reloadCompletionIndexes];
+}
+
+
+- (void)componentRemovedNotification:(NSNotification *)notification {
+    [self reloadCompletionIndexes];
 }
 
 @end
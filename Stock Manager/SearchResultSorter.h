@@ -0,0 +1,33 @@
+//
+//  SearchResultSorter.h
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ Sorts search results the way sort descriptors over their keys would, without key-value coding or
+ a message per comparison. Each key is read once per row into a double: a rating as its value,
+ a number or date as itself and a string as its rank among the strings of its column. Rows are
+ then ordered on those doubles, missing values first or last whatever the direction and ties
+ keeping their order. Results already in order, as SQL returns them, are only checked; long
+ lists are sorted in slices across cores and merged.
+ */
+@interface SearchResultSorter : NSObject
+
+/*
+ Descriptors name dictionary keys; their selector compares strings, and other values are ordered
+ numerically. Absent keys and NSNull are missing values.
+ */
++ (void)sortResults:(NSMutableArray<NSMutableDictionary *> *)results
+    usingDescriptors:(NSArray<NSSortDescriptor *> *)sortDescriptors
+          nullsFirst:(BOOL)nullsFirst;
+
+@end
+
+NS_ASSUME_NONNULL_END
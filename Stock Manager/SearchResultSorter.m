@@ -0,0 +1,276 @@
+//
+//  SearchResultSorter.m
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import "SearchResultSorter.h"
+#import "ComponentRating.h"
+#import <objc/message.h>
+
+#define PARALLEL_SORT_THRESHOLD 65536 //Rows below which slicing across cores costs more than it saves
+#define INSERTION_SORT_LENGTH 16
+
+typedef struct {
+    const double *keys;     //Row after row, keyCount each; NaN where the value is missing
+    const BOOL *ascending;  //Per key
+    size_t keyCount;
+    BOOL nullsFirst;
+} SortKeys;
+
+
+// Negative when the first row goes before the second; ties fall back to the original position, keeping the sort stable
+static int compareRows(const SortKeys *sortKeys, uint32_t first, uint32_t second) {
+    const double *firstKeys = sortKeys->keys + (size_t)first * sortKeys->keyCount;
+    const double *secondKeys = sortKeys->keys + (size_t)second * sortKeys->keyCount;
+    for (size_t key = 0; key < sortKeys->keyCount; key++) {
+        double firstKey = firstKeys[key];
+        double secondKey = secondKeys[key];
+        if (firstKey < secondKey) {
+            return sortKeys->ascending[key] ? -1 : 1;
+        }
+        if (firstKey > secondKey) {
+            return sortKeys->ascending[key] ? 1 : -1;
+        }
+        // Equal, or at least one missing
+        BOOL firstMissing = isnan(firstKey) != 0;
+        if (firstMissing != (isnan(secondKey) != 0)) {
+            return firstMissing == sortKeys->nullsFirst ? -1 : 1;
+        }
+    }
+    return first < second ? -1 : first > second;
+}
+
+
+// Merges the sorted runs [start, middle) and [middle, end) of source into the same range of destination
+static void mergeRuns(const SortKeys *sortKeys, const uint32_t *source, size_t start, size_t middle, size_t end, uint32_t *destination) {
+    size_t left = start;
+    size_t right = middle;
+    for (size_t i = start; i < end; i++) {
+        if (right == end || (left < middle && compareRows(sortKeys, source[left], source[right]) <= 0)) {
+            destination[i] = source[left++];
+        } else {
+            destination[i] = source[right++];
+        }
+    }
+}
+
+
+// Sorts rows[start, end), using the same range of scratch
+static void mergeSort(const SortKeys *sortKeys, uint32_t *rows, uint32_t *scratch, size_t start, size_t end) {
+    if (end - start <= INSERTION_SORT_LENGTH) {
+        for (size_t i = start + 1; i < end; i++) {
+            uint32_t row = rows[i];
+            size_t position = i;
+            while (position > start && compareRows(sortKeys, rows[position - 1], row) > 0) {
+                rows[position] = rows[position - 1];
+                position--;
+            }
+            rows[position] = row;
+        }
+        return;
+    }
+    size_t middle = start + (end - start) / 2;
+    mergeSort(sortKeys, rows, scratch, start, middle);
+    mergeSort(sortKeys, rows, scratch, middle, end);
+    if (compareRows(sortKeys, rows[middle - 1], rows[middle]) < 0) {
+        return; //Runs already in order, as with presorted input
+    }
+    memcpy(scratch + start, rows + start, (end - start) * sizeof(uint32_t));
+    mergeRuns(sortKeys, scratch, start, middle, end, rows);
+}
+
+
+// A power of two, so the merge rounds pair every run
+static size_t sliceCountForRows(size_t count) {
+    size_t sliceCount = 1;
+    if (count >= PARALLEL_SORT_THRESHOLD) {
+        size_t coreCount = [[NSProcessInfo processInfo] activeProcessorCount];
+        while (sliceCount < coreCount) {
+            sliceCount *= 2;
+        }
+    }
+    return sliceCount;
+}
+
+
+static void sortRows(const SortKeys *sortKeys, uint32_t *rows, size_t count) {
+    uint32_t *scratch = malloc(count * sizeof(uint32_t));
+    size_t sliceCount = sliceCountForRows(count);
+    size_t sliceLength = (count + sliceCount - 1) / sliceCount;
+    dispatch_queue_t queue = dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0);
+    dispatch_apply(sliceCount, queue, ^(size_t slice) {
+        size_t start = MIN(slice * sliceLength, count);
+        mergeSort(sortKeys, rows, scratch, start, MIN(start + sliceLength, count));
+    });
+    // Each round merges pairs of sorted runs concurrently, doubling their length
+    for (size_t runLength = sliceLength; runLength < count; runLength *= 2) {
+        size_t pairCount = (count + 2 * runLength - 1) / (2 * runLength);
+        dispatch_apply(pairCount, queue, ^(size_t pair) {
+            size_t start = pair * 2 * runLength;
+            size_t middle = MIN(start + runLength, count);
+            size_t end = MIN(middle + runLength, count);
+            if (middle == end || compareRows(sortKeys, rows[middle - 1], rows[middle]) < 0) {
+                return;
+            }
+            memcpy(scratch + start, rows + start, (end - start) * sizeof(uint32_t));
+            mergeRuns(sortKeys, scratch, start, middle, end, rows);
+        });
+    }
+    free(scratch);
+}
+
+
+// Ratings as their value, numbers as themselves and dates as seconds; anything else is missing
+static double numericKey(id value) {
+    if ([value isKindOfClass:[ComponentRating class]]) {
+        return [(ComponentRating *)value value];
+    } else if ([value isKindOfClass:[NSNumber class]]) {
+        return [(NSNumber *)value doubleValue];
+    } else if ([value isKindOfClass:[NSDate class]]) {
+        return [(NSDate *)value timeIntervalSinceReferenceDate];
+    }
+    return NAN;
+}
+
+
+static BOOL isStringColumn(NSArray<NSDictionary *> *results, NSString *key) {
+    for (NSDictionary *result in results) {
+        id value = [result objectForKey:key];
+        if (value && value != [NSNull null]) {
+            return [value isKindOfClass:[NSString class]];
+        }
+    }
+    return NO;
+}
+
+
+/*
+ Ranks of the strings of a column, keyed by string; strings comparing the same share a rank.
+ A column already in the direction sorted, as the leading one of SQL ordered results, is ranked
+ in one walk; any other has its distinct strings sorted once.
+ */
+static CFDictionaryRef copyStringRanks(NSArray<NSDictionary *> *results, NSString *key, NSComparator comparator, BOOL ascending) {
+    CFMutableDictionaryRef ranks = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &kCFTypeDictionaryKeyCallBacks, NULL);
+    NSString *previous = nil;
+    intptr_t rank = 0;
+    BOOL isOrdered = YES;
+    for (NSDictionary *result in results) {
+        NSString *string = [result objectForKey:key];
+        if (![string isKindOfClass:[NSString class]]) {
+            continue;
+        }
+        if (previous) {
+            NSComparisonResult order = comparator(previous, string);
+            if (order == (ascending ? NSOrderedDescending : NSOrderedAscending)) {
+                isOrdered = NO;
+                break;
+            }
+            if (order != NSOrderedSame) {
+                rank += ascending ? 1 : -1;
+            }
+        }
+        CFDictionarySetValue(ranks, (__bridge const void *)string, (const void *)rank);
+        previous = string;
+    }
+    if (isOrdered) {
+        return ranks;
+    }
+    CFDictionaryRemoveAllValues(ranks);
+    NSMutableSet<NSString *> *strings = [[NSMutableSet alloc] init];
+    for (NSDictionary *result in results) {
+        NSString *string = [result objectForKey:key];
+        if ([string isKindOfClass:[NSString class]]) {
+            [strings addObject:string];
+        }
+    }
+    previous = nil;
+    rank = 0;
+    for (NSString *string in [[strings allObjects] sortedArrayUsingComparator:comparator]) {
+        if (previous && comparator(previous, string) != NSOrderedSame) {
+            rank++;
+        }
+        CFDictionarySetValue(ranks, (__bridge const void *)string, (const void *)rank);
+        previous = string;
+    }
+    return ranks;
+}
+
+@implementation SearchResultSorter
+
++ (void)sortResults:(NSMutableArray<NSMutableDictionary *> *)results
+    usingDescriptors:(NSArray<NSSortDescriptor *> *)sortDescriptors
+          nullsFirst:(BOOL)nullsFirst {
+    size_t count = [results count];
+    size_t keyCount = [sortDescriptors count];
+    if (count < 2 || keyCount == 0) {
+        return;
+    }
+    NSArray<NSMutableDictionary *> *rows = [results copy]; //Read concurrently below
+    NSMutableArray<NSString *> *keyNames = [[NSMutableArray alloc] initWithCapacity:keyCount];
+    BOOL *ascending = malloc(keyCount * sizeof(BOOL));
+    CFDictionaryRef *stringRanks = calloc(keyCount, sizeof(CFDictionaryRef));
+    for (size_t key = 0; key < keyCount; key++) {
+        NSSortDescriptor *sortDescriptor = sortDescriptors[key];
+        [keyNames addObject:[sortDescriptor key]];
+        ascending[key] = [sortDescriptor ascending];
+        if (isStringColumn(rows, [sortDescriptor key])) {
+            SEL selector = [sortDescriptor selector] ?: @selector(compare:);
+            NSComparator comparator = ^NSComparisonResult(NSString *first, NSString *second) {
+                return ((NSComparisonResult (*)(id, SEL, id))objc_msgSend)(first, selector, second);
+            };
+            stringRanks[key] = copyStringRanks(rows, [sortDescriptor key], comparator, ascending[key]);
+        }
+    }
+    double *keys = malloc(count * keyCount * sizeof(double));
+    size_t sliceCount = sliceCountForRows(count);
+    size_t sliceLength = (count + sliceCount - 1) / sliceCount;
+    dispatch_apply(sliceCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t slice) {
+        size_t end = MIN((slice + 1) * sliceLength, count);
+        for (size_t row = slice * sliceLength; row < end; row++) {
+            NSDictionary *result = rows[row];
+            for (size_t key = 0; key < keyCount; key++) {
+                id value = [result objectForKey:keyNames[key]];
+                const void *rank;
+                if (!stringRanks[key]) {
+                    keys[row * keyCount + key] = numericKey(value);
+                } else if ([value isKindOfClass:[NSString class]]
+                           && CFDictionaryGetValueIfPresent(stringRanks[key], (__bridge const void *)value, &rank)) {
+                    keys[row * keyCount + key] = (double)(intptr_t)rank;
+                } else {
+                    keys[row * keyCount + key] = NAN;
+                }
+            }
+        }
+    });
+    for (size_t key = 0; key < keyCount; key++) {
+        if (stringRanks[key]) {
+            CFRelease(stringRanks[key]);
+        }
+    }
+    free(stringRanks);
+    SortKeys sortKeys = { keys, ascending, keyCount, nullsFirst };
+    uint32_t *order = malloc(count * sizeof(uint32_t));
+    BOOL isOrdered = YES;
+    for (size_t row = 0; row < count; row++) {
+        order[row] = (uint32_t)row;
+        if (row > 0 && isOrdered && compareRows(&sortKeys, (uint32_t)row - 1, (uint32_t)row) > 0) {
+            isOrdered = NO;
+        }
+    }
+    if (!isOrdered) {
+        sortRows(&sortKeys, order, count);
+        NSMutableArray<NSMutableDictionary *> *sortedResults = [[NSMutableArray alloc] initWithCapacity:count];
+        for (size_t row = 0; row < count; row++) {
+            [sortedResults addObject:rows[order[row]]];
+        }
+        [results setArray:sortedResults];
+    }
+    free(order);
+    free(keys);
+    free(ascending);
+}
+
+@end
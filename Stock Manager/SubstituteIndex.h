@@ -0,0 +1,29 @@
+//
+//  SubstituteIndex.h
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+@class FMDatabase;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ Finds in-stock substitutes for a component: same type and package code, voltage, current and
+ power ratings at least the original's, values within its tolerance and a tolerance no looser.
+ Each type and package pair has a k-d tree over the log of every rating, so a search visits only
+ the branches overlapping that box and ranks what it finds by distance to the original. A tree is
+ built when first searched and dropped when a component of its group is registered or removed;
+ quantities are kept current from the stock notifications of the sender.
+ */
+@interface SubstituteIndex : NSObject
+
+- (instancetype)initWithDatabase:(FMDatabase *)database notificationSender:(id)sender;
+- (NSArray<NSNumber *> *)substituteIDsForComponentID:(NSNumber *)componentID limit:(NSUInteger)limit;
+
+@end
+
+NS_ASSUME_NONNULL_END
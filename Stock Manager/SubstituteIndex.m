@@ -0,0 +1,413 @@
+//
+//  SubstituteIndex.m
+//  Stock Manager
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import "SubstituteIndex.h"
+#import "ComponentRating.h"
+#import "FMDB.h"
+
+#define DIMENSION_COUNT (ComponentRatingKindTolerance + 1)
+#define FIRST_RATING_COLUMN_INDEX 2 //Position of the first rating in both queries, after the id and quantity or type and package
+#define DEFAULT_VALUE_TOLERANCE 0.01 //Fraction a value may deviate when the original has no tolerance rating
+
+typedef struct {
+    double coordinates[DIMENSION_COUNT]; //Log of each rating, minus infinity where it is unknown
+    int64_t componentID;
+    int64_t quantity;
+    int splitDimension; //Of the subtree whose median this point is
+} SubstitutePoint;
+
+typedef struct {
+    double lower[DIMENSION_COUNT]; //Box a substitute must lie in
+    double upper[DIMENSION_COUNT];
+    double origin[DIMENSION_COUNT]; //The original's coordinates
+    BOOL known[DIMENSION_COUNT];    //The original has this rating, so it counts toward the distance
+    int64_t originalID;
+} SubstituteQuery;
+
+typedef struct {
+    int64_t componentID;
+    double distance;
+} Neighbour;
+
+typedef struct {
+    Neighbour *items; //Nearest first
+    size_t count;
+    size_t limit;
+} Neighbours;
+
+
+static void swapPoints(SubstitutePoint *points, size_t first, size_t second) {
+    SubstitutePoint point = points[first];
+    points[first] = points[second];
+    points[second] = point;
+}
+
+
+// Reorders points so the one at index has every lower coordinate before it and every higher after it
+static void selectPoint(SubstitutePoint *points, size_t count, size_t index, int dimension) {
+    size_t left = 0;
+    size_t right = count - 1;
+    while (left < right) {
+        swapPoints(points, left + (right - left) / 2, right);
+        double pivot = points[right].coordinates[dimension];
+        size_t store = left;
+        for (size_t i = left; i < right; i++) {
+            if (points[i].coordinates[dimension] < pivot) {
+                swapPoints(points, i, store++);
+            }
+        }
+        swapPoints(points, store, right);
+        if (store == index) {
+            return;
+        } else if (store < index) {
+            left = store + 1;
+        } else {
+            right = store - 1;
+        }
+    }
+}
+
+
+// An implicit tree: each subtree's median splits the rest into its two halves
+static void buildTree(SubstitutePoint *points, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    // Split on the widest spread of known ratings, so unrated dimensions are never chosen over rated ones
+    int splitDimension = 0;
+    double widestSpread = -1.0;
+    for (int dimension = 0; dimension < DIMENSION_COUNT; dimension++) {
+        double minimum = INFINITY;
+        double maximum = -INFINITY;
+        for (size_t i = 0; i < count; i++) {
+            double coordinate = points[i].coordinates[dimension];
+            if (isfinite(coordinate)) {
+                minimum = MIN(minimum, coordinate);
+                maximum = MAX(maximum, coordinate);
+            }
+        }
+        if (maximum >= minimum && maximum - minimum > widestSpread) {
+            widestSpread = maximum - minimum;
+            splitDimension = dimension;
+        }
+    }
+    size_t median = count / 2;
+    selectPoint(points, count, median, splitDimension);
+    points[median].splitDimension = splitDimension;
+    buildTree(points, median);
+    buildTree(points + median + 1, count - median - 1);
+}
+
+
+// Insertion into a short sorted array; limits are a few tens of entries
+static void rankNeighbour(Neighbours *neighbours, int64_t componentID, double distance) {
+    if (neighbours->count == neighbours->limit && distance >= neighbours->items[neighbours->count - 1].distance) {
+        return;
+    }
+    size_t position = neighbours->count < neighbours->limit ? neighbours->count++ : neighbours->count - 1;
+    while (position > 0 && distance < neighbours->items[position - 1].distance) {
+        neighbours->items[position] = neighbours->items[position - 1];
+        position--;
+    }
+    neighbours->items[position] = (Neighbour){ componentID, distance };
+}
+
+
+static void considerPoint(const SubstitutePoint *point, const SubstituteQuery *query, Neighbours *neighbours) {
+    if (point->componentID == query->originalID || point->quantity <= 0) {
+        return;
+    }
+    double distance = 0.0;
+    for (int dimension = 0; dimension < DIMENSION_COUNT; dimension++) {
+        double coordinate = point->coordinates[dimension];
+        if (coordinate < query->lower[dimension] || coordinate > query->upper[dimension]) {
+            return;
+        }
+        if (query->known[dimension]) {
+            double difference = coordinate - query->origin[dimension];
+            distance += difference * difference;
+        }
+    }
+    rankNeighbour(neighbours, point->componentID, distance);
+}
+
+
+static void searchTree(const SubstitutePoint *points, size_t count, const SubstituteQuery *query, Neighbours *neighbours) {
+    if (count == 0) {
+        return;
+    }
+    size_t median = count / 2;
+    const SubstitutePoint *point = &points[median];
+    considerPoint(point, query, neighbours);
+    int dimension = point->splitDimension;
+    double split = point->coordinates[dimension];
+    // Equal coordinates may lie on either side of the median
+    BOOL lowerOverlaps = query->lower[dimension] <= split;
+    BOOL upperOverlaps = query->upper[dimension] >= split;
+    // The original's side first, so the other is more often beyond the farthest neighbour
+    BOOL lowerFirst = !query->known[dimension] || query->origin[dimension] <= split;
+    double planeDistance = query->known[dimension] ? (query->origin[dimension] - split) * (query->origin[dimension] - split) : 0.0;
+    for (int pass = 0; pass < 2; pass++) {
+        BOOL lower = (pass == 0) == lowerFirst;
+        if (!(lower ? lowerOverlaps : upperOverlaps)) {
+            continue;
+        }
+        if (pass == 1 && neighbours->count == neighbours->limit && planeDistance >= neighbours->items[neighbours->count - 1].distance) {
+            continue;
+        }
+        if (lower) {
+            searchTree(points, median, query, neighbours);
+        } else {
+            searchTree(points + median + 1, count - median - 1, query, neighbours);
+        }
+    }
+}
+
+
+static void getCoordinates(FMResultSet *resultSet, double *coordinates) {
+    for (int dimension = 0; dimension < DIMENSION_COUNT; dimension++) {
+        int columnIndex = FIRST_RATING_COLUMN_INDEX + dimension;
+        double rating = [resultSet columnIndexIsNull:columnIndex] ? 0.0 : [resultSet doubleForColumnIndex:columnIndex];
+        coordinates[dimension] = rating > 0.0 ? log10(rating) : -INFINITY;
+    }
+}
+
+#pragma mark -
+
+// The points of one type and package code, with where each component's point ended up
+@interface SubstituteTree : NSObject
+
+@property (readonly) SubstitutePoint *points;
+@property (readonly) size_t count;
+
+- (instancetype)initWithPoints:(SubstitutePoint *)points count:(size_t)count;
+- (void)setQuantity:(int64_t)quantity forComponentID:(int64_t)componentID;
+
+@end
+
+@implementation SubstituteTree {
+    CFMutableDictionaryRef _positions; //Component id to point index, both stored as plain integers
+}
+
+- (instancetype)initWithPoints:(SubstitutePoint *)points count:(size_t)count {
+    self = [super init];
+    if (self) {
+        _points = points;
+        _count = count;
+        buildTree(_points, _count);
+        _positions = CFDictionaryCreateMutable(kCFAllocatorDefault, (CFIndex)count, NULL, NULL);
+        for (size_t i = 0; i < count; i++) {
+            CFDictionarySetValue(_positions, (const void *)(intptr_t)_points[i].componentID, (const void *)(uintptr_t)i);
+        }
+    }
+    return self;
+}
+
+
+- (void)dealloc {
+    free(_points);
+    CFRelease(_positions);
+}
+
+
+- (void)setQuantity:(int64_t)quantity forComponentID:(int64_t)componentID {
+    const void *value = NULL;
+    if (CFDictionaryGetValueIfPresent(_positions, (const void *)(intptr_t)componentID, &value)) {
+        _points[(uintptr_t)value].quantity = quantity;
+    }
+}
+
+@end
+
+#pragma mark -
+
+@interface SubstituteIndex ()
+
+@property FMDatabase *database;
+@property NSString *ratingColumnList;
+@property NSMutableDictionary<NSArray *, SubstituteTree *> *trees; //By type and package code ids, NSNull for no package
+@property NSMutableDictionary<NSNumber *, NSArray *> *groupKeys; //Of every component in a built tree
+
+@end
+
+@implementation SubstituteIndex
+
+- (instancetype)initWithDatabase:(FMDatabase *)database notificationSender:(id)sender {
+    self = [super init];
+    if (self) {
+        _database = database;
+        _trees = [[NSMutableDictionary alloc] init];
+        _groupKeys = [[NSMutableDictionary alloc] init];
+        NSMutableArray<NSString *> *columns = [[NSMutableArray alloc] initWithCapacity:DIMENSION_COUNT];
+        for (NSInteger kind = 0; kind < DIMENSION_COUNT; kind++) {
+            [columns addObject:[ComponentRating columnNameForKind:kind]];
+        }
+        _ratingColumnList = [columns componentsJoinedByString:@", "];
+        NSNotificationCenter *notificationCenter = [NSNotificationCenter defaultCenter];
+        [notificationCenter addObserver:self
+                               selector:@selector(stockUpdatedNotification:)
+                                   name:@"DBCStockUpdatedNotification"
+                                 object:sender];
+        [notificationCenter addObserver:self
+                               selector:@selector(kitWithdrawnNotification:)
+                                   name:@"DBCKitWithdrawnNotification"
+                                 object:sender];
+        [notificationCenter addObserver:self
+                               selector:@selector(componentRegisteredNotification:)
+                                   name:@"DBCComponentRegisteredNotification"
+                                 object:sender];
+        [notificationCenter addObserver:self
+                               selector:@selector(componentRemovedNotification:)
+                                   name:@"DBCComponentRemovedNotification"
+                                 object:sender];
+    }
+    return self;
+}
+
+
+- (void)dealloc {
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+
+- (NSArray *)groupKeyForResultSet:(FMResultSet *)resultSet {
+    // Type and package code ids are the first two columns
+    return @[[resultSet objectForColumnIndex:0], [resultSet objectForColumnIndex:1]];
+}
+
+
+- (SubstituteTree *)treeForGroupKey:(NSArray *)groupKey {
+    SubstituteTree *tree = [_trees objectForKey:groupKey];
+    if (tree) {
+        return tree;
+    }
+    NSString *query = [NSString stringWithFormat:@"SELECT component_id, quantity, %@ FROM stock WHERE component_type_id = ? AND package_code_id IS ?", _ratingColumnList];
+    FMResultSet *resultSet = [_database executeQuery:query, [groupKey objectAtIndex:0], [groupKey objectAtIndex:1]];
+    size_t capacity = 64;
+    size_t count = 0;
+    SubstitutePoint *points = malloc(capacity * sizeof(SubstitutePoint));
+    while ([resultSet next]) {
+        if (count == capacity) {
+            capacity *= 2;
+            points = realloc(points, capacity * sizeof(SubstitutePoint));
+        }
+        SubstitutePoint *point = &points[count++];
+        point->componentID = [resultSet longLongIntForColumnIndex:0];
+        point->quantity = [resultSet longLongIntForColumnIndex:1];
+        getCoordinates(resultSet, point->coordinates);
+        point->splitDimension = 0;
+        [_groupKeys setObject:groupKey forKey:[NSNumber numberWithLongLong:point->componentID]];
+    }
+    [resultSet close];
+    tree = [[SubstituteTree alloc] initWithPoints:points count:count];
+    [_trees setObject:tree forKey:groupKey];
+    return tree;
+}
+
+
+- (NSArray<NSNumber *> *)substituteIDsForComponentID:(NSNumber *)componentID limit:(NSUInteger)limit {
+    NSString *query = [NSString stringWithFormat:@"SELECT component_type_id, package_code_id, %@ FROM stock WHERE component_id = ?", _ratingColumnList];
+    FMResultSet *resultSet = [_database executeQuery:query, componentID];
+    if (limit == 0 || ![resultSet next]) {
+        [resultSet close];
+        return @[];
+    }
+    NSArray *groupKey = [self groupKeyForResultSet:resultSet];
+    SubstituteQuery substituteQuery;
+    substituteQuery.originalID = [componentID longLongValue];
+    getCoordinates(resultSet, substituteQuery.origin);
+    [resultSet close];
+    double toleranceRating = substituteQuery.origin[ComponentRatingKindTolerance];
+    double valueTolerance = isfinite(toleranceRating) ? pow(10.0, toleranceRating) / 100.0 : DEFAULT_VALUE_TOLERANCE;
+    for (int dimension = 0; dimension < DIMENSION_COUNT; dimension++) {
+        double origin = substituteQuery.origin[dimension];
+        substituteQuery.known[dimension] = isfinite(origin);
+        substituteQuery.lower[dimension] = -INFINITY;
+        substituteQuery.upper[dimension] = INFINITY;
+        if (!substituteQuery.known[dimension]) {
+            continue;
+        }
+        switch (dimension) {
+            case ComponentRatingKindVoltage:
+            case ComponentRatingKindCurrent:
+            case ComponentRatingKindPower:
+                substituteQuery.lower[dimension] = origin;
+                break;
+            case ComponentRatingKindTolerance:
+                // An unknown tolerance can't be shown to be as tight
+                substituteQuery.lower[dimension] = -DBL_MAX;
+                substituteQuery.upper[dimension] = origin;
+                break;
+            default:
+                substituteQuery.lower[dimension] = valueTolerance < 1.0 ? origin + log10(1.0 - valueTolerance) : -DBL_MAX;
+                substituteQuery.upper[dimension] = origin + log10(1.0 + valueTolerance);
+                break;
+        }
+    }
+    SubstituteTree *tree = [self treeForGroupKey:groupKey];
+    Neighbours neighbours = { malloc(limit * sizeof(Neighbour)), 0, limit };
+    searchTree([tree points], [tree count], &substituteQuery, &neighbours);
+    NSMutableArray<NSNumber *> *substituteIDs = [[NSMutableArray alloc] initWithCapacity:neighbours.count];
+    for (size_t i = 0; i < neighbours.count; i++) {
+        [substituteIDs addObject:[NSNumber numberWithLongLong:neighbours.items[i].componentID]];
+    }
+    free(neighbours.items);
+    return substituteIDs;
+}
+
+
+- (void)invalidateGroupOfComponentID:(NSNumber *)componentID {
+    NSArray *groupKey = [_groupKeys objectForKey:componentID];
+    if (!groupKey) {
+        return;
+    }
+    [_trees removeObjectForKey:groupKey];
+    [_groupKeys removeObjectForKey:componentID];
+}
+
+
+- (void)setQuantity:(NSNumber *)quantity forComponentID:(NSNumber *)componentID {
+    NSArray *groupKey = [_groupKeys objectForKey:componentID];
+    if (groupKey) {
+        [[_trees objectForKey:groupKey] setQuantity:[quantity longLongValue] forComponentID:[componentID longLongValue]];
+    }
+}
+
+#pragma mark - Notification Handlers
+
+- (void)stockUpdatedNotification:(NSNotification *)notification {
+    [self setQuantity:[[notification userInfo] objectForKey:@"UpdatedQuantity"]
+       forComponentID:[[notification userInfo] objectForKey:@"UpdatedComponentID"]];
+}
+
+
+- (void)kitWithdrawnNotification:(NSNotification *)notification {
+    NSDictionary<NSNumber *, NSNumber *> *updatedQuantities = [[notification userInfo] objectForKey:@"UpdatedQuantities"];
+    [updatedQuantities enumerateKeysAndObjectsUsingBlock:^(NSNumber *componentID, NSNumber *quantity, BOOL *stop) {
+        [self setQuantity:quantity forComponentID:componentID];
+    }];
+}
+
+
+- (void)componentRegisteredNotification:(NSNotification *)notification {
+    // An edit may move the component between groups, so both its former and its current group are rebuilt
+    NSNumber *componentID = [[notification userInfo] objectForKey:@"ComponentID"];
+    [self invalidateGroupOfComponentID:componentID];
+    FMResultSet *resultSet = [_database executeQuery:@"SELECT component_type_id, package_code_id FROM stock WHERE component_id = ?", componentID];
+    if ([resultSet next]) {
+        [_trees removeObjectForKey:[self groupKeyForResultSet:resultSet]];
+    }
+    [resultSet close];
+}
+
+
+- (void)componentRemovedNotification:(NSNotification *)notification {
+    [self invalidateGroupOfComponentID:[[notification userInfo] objectForKey:@"ComponentID"]];
+}
+
+@end
@@ -0,0 +1,31 @@
+//
+//  InventoryServer.h
+//  Stock Service
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+@class InventoryStore;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ Minimal HTTP/1.1 front end for an InventoryStore. Routes:
+ GET  /components?part_number=<prefix>
+ GET  /components?component_type=<type>
+ GET  /components/<id>
+ GET  /components/<id>/history
+ POST /components/<id>/movements  {"kind": "acquisition"|"expenditure", "quantity": n, "date": "<ISO 8601>", "party": "..."}
+ */
+@interface InventoryServer : NSObject
+
+- (instancetype)initWithStore:(InventoryStore *)store;
+- (BOOL)listenOnPort:(uint16_t)port;
+- (BOOL)listenOnSocketPath:(NSString *)path;
+- (void)stop;
+
+@end
+
+NS_ASSUME_NONNULL_END
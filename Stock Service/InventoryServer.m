@@ -0,0 +1,441 @@
+//
+//  InventoryServer.m
+//  Stock Service
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import "InventoryServer.h"
+#import "InventoryStore.h"
+#import <sys/socket.h>
+#import <sys/un.h>
+#import <netinet/in.h>
+#import <netinet/tcp.h>
+#import <arpa/inet.h>
+#import <fcntl.h>
+#import <unistd.h>
+
+#define LISTEN_BACKLOG 512
+#define READ_CHUNK_SIZE 16384
+#define MAX_HEADER_LENGTH 16384
+#define MAX_BODY_LENGTH 65536
+
+@class HTTPConnection;
+
+@interface InventoryServer ()
+
+@property InventoryStore *store;
+@property NSISO8601DateFormatter *dateFormatter;
+@property int listeningSocket;
+@property dispatch_source_t acceptSource;
+
+- (void)handleRequestWithMethod:(NSString *)method
+                         target:(NSString *)target
+                           body:(NSData *)body
+                     completion:(void (^)(NSInteger status, id responseObject))completion;
+
+@end
+
+#pragma mark - HTTPConnection
+
+@interface HTTPConnection : NSObject
+
+@property (weak) InventoryServer *server;
+@property int socket;
+@property dispatch_queue_t queue;
+@property dispatch_source_t readSource;
+@property NSMutableData *buffer;
+@property BOOL requestInFlight;
+@property BOOL readingSuspended;
+@property BOOL closed;
+
+- (instancetype)initWithSocket:(int)socket server:(InventoryServer *)server;
+- (void)start;
+
+@end
+
+@implementation HTTPConnection
+
+- (instancetype)initWithSocket:(int)socket server:(InventoryServer *)server {
+    self = [super init];
+    if (self) {
+        _socket = socket;
+        _server = server;
+        _buffer = [[NSMutableData alloc] init];
+        _queue = dispatch_queue_create("org.solstice.stock-service.connection", DISPATCH_QUEUE_SERIAL);
+        int enabled = 1;
+        setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled)); //Fails harmlessly on Unix sockets
+    }
+    return self;
+}
+
+
+- (void)start {
+    _readSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, (uintptr_t)_socket, 0, _queue);
+    // The source retains the connection until it is cancelled
+    dispatch_source_set_event_handler(_readSource, ^{
+        [self readAvailableData];
+    });
+    int socket = _socket;
+    dispatch_source_set_cancel_handler(_readSource, ^{
+        close(socket);
+    });
+    dispatch_resume(_readSource);
+}
+
+
+- (void)readAvailableData {
+    uint8_t chunk[READ_CHUNK_SIZE];
+    ssize_t bytesRead = read(_socket, chunk, sizeof(chunk));
+    if (bytesRead < 0 && (errno == EINTR || errno == EAGAIN)) {
+        return; //The source fires again while data is pending
+    }
+    if (bytesRead <= 0) {
+        [self closeConnection];
+        return;
+    }
+    [_buffer appendBytes:chunk length:(NSUInteger)bytesRead];
+    [self processBufferedRequests];
+}
+
+
+- (void)processBufferedRequests {
+    if (_requestInFlight || _closed) {
+        return;
+    }
+    NSData *headerTerminator = [@"\r\n\r\n" dataUsingEncoding:NSASCIIStringEncoding];
+    NSRange terminatorRange = [_buffer rangeOfData:headerTerminator options:0 range:NSMakeRange(0, [_buffer length])];
+    if (terminatorRange.location == NSNotFound) {
+        if ([_buffer length] > MAX_HEADER_LENGTH) {
+            [self sendStatus:431 object:@{ @"error" : @"Request header too large." } keepAlive:NO];
+        }
+        return;
+    }
+    NSData *headerData = [_buffer subdataWithRange:NSMakeRange(0, terminatorRange.location)];
+    NSString *header = [[NSString alloc] initWithData:headerData encoding:NSISOLatin1StringEncoding];
+    NSArray<NSString *> *lines = [header componentsSeparatedByString:@"\r\n"];
+    NSArray<NSString *> *requestLine = [lines[0] componentsSeparatedByString:@" "];
+    if ([requestLine count] != 3) {
+        [self sendStatus:400 object:@{ @"error" : @"Malformed request line." } keepAlive:NO];
+        return;
+    }
+    NSUInteger contentLength = 0;
+    BOOL keepAlive = ![requestLine[2] isEqualToString:@"HTTP/1.0"];
+    for (NSUInteger i = 1; i < [lines count]; i++) {
+        NSRange separator = [lines[i] rangeOfString:@":"];
+        if (separator.location == NSNotFound) {
+            continue;
+        }
+        NSString *name = [[lines[i] substringToIndex:separator.location] lowercaseString];
+        NSString *value = [[lines[i] substringFromIndex:separator.location + 1] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+        if ([name isEqualToString:@"content-length"]) {
+            contentLength = (NSUInteger)[value integerValue];
+        } else if ([name isEqualToString:@"connection"]) {
+            keepAlive = [[value lowercaseString] isEqualToString:@"keep-alive"] || (keepAlive && ![[value lowercaseString] isEqualToString:@"close"]);
+        }
+    }
+    if (contentLength > MAX_BODY_LENGTH) {
+        [self sendStatus:413 object:@{ @"error" : @"Request body too large." } keepAlive:NO];
+        return;
+    }
+    NSUInteger bodyOffset = NSMaxRange(terminatorRange);
+    if ([_buffer length] < bodyOffset + contentLength) {
+        return; //Wait for the rest of the body
+    }
+    NSData *body = [_buffer subdataWithRange:NSMakeRange(bodyOffset, contentLength)];
+    [_buffer replaceBytesInRange:NSMakeRange(0, bodyOffset + contentLength) withBytes:NULL length:0];
+    // Requests on a connection are answered in order; stop reading until this one is done
+    [self setRequestInFlight:YES];
+    [self setReadingSuspended:YES];
+    dispatch_suspend(_readSource);
+    [_server handleRequestWithMethod:requestLine[0]
+                              target:requestLine[1]
+                                body:body
+                          completion:^(NSInteger status, id responseObject) {
+        dispatch_async(self->_queue, ^{
+            [self setRequestInFlight:NO];
+            [self resumeReading];
+            [self sendStatus:status object:responseObject keepAlive:keepAlive];
+            [self processBufferedRequests];
+        });
+    }];
+}
+
+
+- (void)sendStatus:(NSInteger)status object:(id)responseObject keepAlive:(BOOL)keepAlive {
+    if (_closed) {
+        return;
+    }
+    NSData *body = [NSJSONSerialization dataWithJSONObject:responseObject options:0 error:nil] ?: [NSData data];
+    NSString *header = [NSString stringWithFormat:@"HTTP/1.1 %ld %@\r\nContent-Type: application/json\r\nContent-Length: %lu\r\nConnection: %@\r\n\r\n",
+                        (long)status,
+                        [HTTPConnection reasonPhraseForStatus:status],
+                        (unsigned long)[body length],
+                        keepAlive ? @"keep-alive" : @"close"];
+    NSMutableData *response = [[header dataUsingEncoding:NSASCIIStringEncoding] mutableCopy];
+    [response appendData:body];
+    const uint8_t *bytes = [response bytes];
+    NSUInteger remaining = [response length];
+    while (remaining > 0) {
+        ssize_t written = write(_socket, bytes, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            [self closeConnection];
+            return;
+        }
+        bytes += written;
+        remaining -= (NSUInteger)written;
+    }
+    if (!keepAlive) {
+        [self closeConnection];
+    }
+}
+
+
+- (void)closeConnection {
+    if (_closed) {
+        return;
+    }
+    [self setClosed:YES];
+    [self resumeReading]; //A suspended source never delivers its cancellation
+    dispatch_source_cancel(_readSource);
+}
+
+
+- (void)resumeReading {
+    if (_readingSuspended) {
+        [self setReadingSuspended:NO];
+        dispatch_resume(_readSource);
+    }
+}
+
+
++ (NSString *)reasonPhraseForStatus:(NSInteger)status {
+    switch (status) {
+        case 200: return @"OK";
+        case 400: return @"Bad Request";
+        case 404: return @"Not Found";
+        case 405: return @"Method Not Allowed";
+        case 409: return @"Conflict";
+        case 413: return @"Payload Too Large";
+        case 431: return @"Request Header Fields Too Large";
+        default: return @"Internal Server Error";
+    }
+}
+
+@end
+
+#pragma mark - InventoryServer
+
+@implementation InventoryServer
+
+- (instancetype)initWithStore:(InventoryStore *)store {
+    self = [super init];
+    if (self) {
+        _store = store;
+        _dateFormatter = [[NSISO8601DateFormatter alloc] init];
+        [_dateFormatter setTimeZone:[NSTimeZone localTimeZone]];
+        _listeningSocket = -1;
+    }
+    return self;
+}
+
+
+- (BOOL)listenOnPort:(uint16_t)port {
+    int listeningSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (listeningSocket < 0) {
+        NSLog(@"Service failed to create socket: %s.", strerror(errno));
+        return NO;
+    }
+    int enabled = 1;
+    setsockopt(listeningSocket, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_len = sizeof(address);
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); //Local stations only
+    if (bind(listeningSocket, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        NSLog(@"Service failed to bind port %u: %s.", port, strerror(errno));
+        close(listeningSocket);
+        return NO;
+    }
+    return [self acceptConnectionsOnSocket:listeningSocket];
+}
+
+
+- (BOOL)listenOnSocketPath:(NSString *)path {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    const char *fileSystemPath = [path fileSystemRepresentation];
+    if (strlen(fileSystemPath) >= sizeof(address.sun_path)) {
+        NSLog(@"Socket path '%@' is too long.", path);
+        return NO;
+    }
+    int listeningSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listeningSocket < 0) {
+        NSLog(@"Service failed to create socket: %s.", strerror(errno));
+        return NO;
+    }
+    address.sun_len = sizeof(address);
+    address.sun_family = AF_UNIX;
+    strlcpy(address.sun_path, fileSystemPath, sizeof(address.sun_path));
+    unlink(fileSystemPath); //Stale socket from a previous run
+    if (bind(listeningSocket, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        NSLog(@"Service failed to bind socket '%@': %s.", path, strerror(errno));
+        close(listeningSocket);
+        return NO;
+    }
+    return [self acceptConnectionsOnSocket:listeningSocket];
+}
+
+
+- (BOOL)acceptConnectionsOnSocket:(int)listeningSocket {
+    if (listen(listeningSocket, LISTEN_BACKLOG) < 0) {
+        NSLog(@"Service failed to listen: %s.", strerror(errno));
+        close(listeningSocket);
+        return NO;
+    }
+    fcntl(listeningSocket, F_SETFL, O_NONBLOCK);
+    [self setListeningSocket:listeningSocket];
+    dispatch_queue_t acceptQueue = dispatch_queue_create("org.solstice.stock-service.accept", DISPATCH_QUEUE_SERIAL);
+    [self setAcceptSource:dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, (uintptr_t)listeningSocket, 0, acceptQueue)];
+    __weak InventoryServer *weakSelf = self;
+    dispatch_source_set_event_handler(_acceptSource, ^{
+        InventoryServer *server = weakSelf;
+        int connectionSocket;
+        while ((connectionSocket = accept(listeningSocket, NULL, NULL)) >= 0) {
+            // Accepted sockets inherit O_NONBLOCK on macOS; responses are written whole on the connection's own queue
+            fcntl(connectionSocket, F_SETFL, fcntl(connectionSocket, F_GETFL) & ~O_NONBLOCK);
+            HTTPConnection *connection = [[HTTPConnection alloc] initWithSocket:connectionSocket server:server];
+            [connection start];
+        }
+    });
+    dispatch_source_set_cancel_handler(_acceptSource, ^{
+        close(listeningSocket);
+    });
+    dispatch_resume(_acceptSource);
+    return YES;
+}
+
+
+- (void)stop {
+    if (_acceptSource) {
+        dispatch_source_cancel(_acceptSource);
+        [self setAcceptSource:nil];
+    }
+}
+
+#pragma mark - Routing
+
+- (void)handleRequestWithMethod:(NSString *)method
+                         target:(NSString *)target
+                           body:(NSData *)body
+                     completion:(void (^)(NSInteger status, id responseObject))completion {
+    NSURLComponents *urlComponents = [NSURLComponents componentsWithString:target];
+    NSArray<NSString *> *pathComponents = [[urlComponents path] pathComponents];
+    // pathComponents of "/components/12/history" is ("/", "components", "12", "history")
+    if ([pathComponents count] < 2 || ![pathComponents[1] isEqualToString:@"components"]) {
+        completion(404, @{ @"error" : @"Unknown resource." });
+        return;
+    }
+    if ([pathComponents count] == 2) {
+        if (![method isEqualToString:@"GET"]) {
+            completion(405, @{ @"error" : @"Method not allowed." });
+            return;
+        }
+        NSString *partNumber = nil;
+        NSString *componentType = nil;
+        for (NSURLQueryItem *item in [urlComponents queryItems]) {
+            if ([[item name] isEqualToString:@"part_number"]) {
+                partNumber = [item value];
+            } else if ([[item name] isEqualToString:@"component_type"]) {
+                componentType = [item value];
+            }
+        }
+        if ([partNumber length] > 0) {
+            completion(200, [_store componentsWithPartNumberPrefix:partNumber]);
+        } else if ([componentType length] > 0) {
+            completion(200, [_store componentsOfType:componentType]);
+        } else {
+            completion(400, @{ @"error" : @"Either part_number or component_type is required." });
+        }
+        return;
+    }
+    NSNumber *componentID = [NSNumber numberWithInteger:[pathComponents[2] integerValue]];
+    if ([pathComponents count] == 3 && [method isEqualToString:@"GET"]) {
+        NSDictionary *component = [_store componentWithID:componentID];
+        if (component) {
+            completion(200, component);
+        } else {
+            completion(404, @{ @"error" : @"No such component." });
+        }
+    } else if ([pathComponents count] == 4 && [pathComponents[3] isEqualToString:@"history"] && [method isEqualToString:@"GET"]) {
+        completion(200, [_store historyForComponentID:componentID]);
+    } else if ([pathComponents count] == 4 && [pathComponents[3] isEqualToString:@"movements"] && [method isEqualToString:@"POST"]) {
+        [self recordMovementForComponentID:componentID body:body completion:completion];
+    } else {
+        completion(404, @{ @"error" : @"Unknown resource." });
+    }
+}
+
+
+- (void)recordMovementForComponentID:(NSNumber *)componentID
+                                body:(NSData *)body
+                          completion:(void (^)(NSInteger status, id responseObject))completion {
+    id request = [NSJSONSerialization JSONObjectWithData:body options:0 error:nil];
+    if (![request isKindOfClass:[NSDictionary class]]) {
+        completion(400, @{ @"error" : @"Body must be a JSON object." });
+        return;
+    }
+    // JSON decodes true and false as numbers too, and any number may carry a fraction
+    NSNumber *quantity = [request objectForKey:@"quantity"];
+    if (![quantity isKindOfClass:[NSNumber class]] || CFGetTypeID((__bridge CFTypeRef)quantity) == CFBooleanGetTypeID()
+        || [quantity doubleValue] != (double)[quantity integerValue] || [quantity integerValue] <= 0) {
+        completion(400, @{ @"error" : @"Quantity must be a positive integer." });
+        return;
+    }
+    NSString *kind = [request objectForKey:@"kind"];
+    if (![kind isKindOfClass:[NSString class]] || !([kind isEqualToString:@"acquisition"] || [kind isEqualToString:@"expenditure"])) {
+        completion(400, @{ @"error" : @"Kind must be either \"acquisition\" or \"expenditure\"." });
+        return;
+    }
+    NSMutableDictionary *parameters = [[NSMutableDictionary alloc] initWithDictionary:@{
+        @"component_id" : componentID,
+        @"quantity"     : quantity,
+        @"kind"         : kind
+    }];
+    id dateString = [request objectForKey:@"date"];
+    if (dateString && dateString != [NSNull null]) {
+        NSDate *date = [dateString isKindOfClass:[NSString class]] ? [_dateFormatter dateFromString:dateString] : nil;
+        if (!date) {
+            completion(400, @{ @"error" : @"Date must be in ISO 8601 format." });
+            return;
+        }
+        [parameters setObject:date forKey:@"date"];
+    }
+    id party = [request objectForKey:@"party"];
+    if (party && party != [NSNull null] && ![party isKindOfClass:[NSString class]]) {
+        completion(400, @{ @"error" : @"Party must be a string." });
+        return;
+    }
+    if ([party isKindOfClass:[NSString class]] && [party length] > 0) {
+        [parameters setObject:party forKey:@"party"];
+    }
+    [_store recordMovementWithParameters:parameters completion:^(NSNumber *updatedQuantity, NSString *errorDescription) {
+        if (updatedQuantity) {
+            completion(200, @{
+                @"component_id" : componentID,
+                @"quantity"     : updatedQuantity
+            });
+        } else {
+            completion(409, @{ @"error" : errorDescription ?: @"Movement rejected." });
+        }
+    }];
+}
+
+@end
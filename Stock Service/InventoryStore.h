@@ -0,0 +1,28 @@
+//
+//  InventoryStore.h
+//  Stock Service
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef void (^InventoryMovementCompletion)(NSNumber * _Nullable updatedQuantity, NSString * _Nullable errorDescription);
+
+@interface InventoryStore : NSObject
+
+- (nullable instancetype)initWithPath:(NSString *)path readerCount:(NSUInteger)readerCount;
+- (void)close;
+- (NSArray<NSDictionary *> *)componentsWithPartNumberPrefix:(NSString *)prefix;
+- (NSArray<NSDictionary *> *)componentsOfType:(NSString *)type;
+- (nullable NSDictionary *)componentWithID:(NSNumber *)componentID;
+- (NSDictionary *)historyForComponentID:(NSNumber *)componentID;
+- (void)recordMovementWithParameters:(NSDictionary *)parameters
+                          completion:(InventoryMovementCompletion)completion;
+
+@end
+
+NS_ASSUME_NONNULL_END
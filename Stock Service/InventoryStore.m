@@ -0,0 +1,303 @@
+//
+//  InventoryStore.m
+//  Stock Service
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import "InventoryStore.h"
+#import "FMDB.h"
+#import "ConsumptionForecaster.h"
+
+#define MAX_MOVEMENTS_PER_COMMIT 256
+
+@interface PendingMovement : NSObject
+
+@property NSDictionary *parameters;
+@property (copy) InventoryMovementCompletion completion;
+@property NSNumber *updatedQuantity;
+@property NSString *errorDescription;
+
+@end
+
+@implementation PendingMovement
+@end
+
+#pragma mark -
+
+@interface InventoryStore ()
+
+@property FMDatabasePool *readerPool;
+@property dispatch_semaphore_t readerSlots;
+@property FMDatabase *writer;
+@property dispatch_queue_t writerQueue;
+@property NSLock *pendingLock;
+@property NSMutableArray<PendingMovement *> *pendingMovements;
+@property BOOL drainScheduled;
+@property NSISO8601DateFormatter *dateFormatter;
+@property BOOL tracksConsumption;
+@property NSString *componentSource; //Table or view read for components, with their names in text columns
+
+@end
+
+@implementation InventoryStore
+
+- (nullable instancetype)initWithPath:(NSString *)path readerCount:(NSUInteger)readerCount {
+    self = [super init];
+    if (self) {
+        _dateFormatter = [[NSISO8601DateFormatter alloc] init];
+        [_dateFormatter setTimeZone:[NSTimeZone localTimeZone]];
+        _pendingLock = [[NSLock alloc] init];
+        _pendingMovements = [[NSMutableArray alloc] init];
+        _writerQueue = dispatch_queue_create("org.solstice.stock-service.writer", DISPATCH_QUEUE_SERIAL);
+        // The single writer owns the file; readers never contend with it under WAL journaling
+        _writer = [FMDatabase databaseWithPath:path];
+        if (![_writer openWithFlags:SQLITE_OPEN_READWRITE]) {
+            NSLog(@"Service failed to open database file '%@'.", path);
+            return nil;
+        }
+        if (![_writer goodConnection]) {
+            NSLog(@"Bad database file '%@'.", path);
+            [_writer close];
+            return nil;
+        }
+        [_writer setDateFormat:_dateFormatter];
+        [_writer setMaxBusyRetryTimeInterval:5.0];
+        [_writer executeStatements:@"PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;"];
+        // Databases not yet migrated by the application to schema v1.9 have no consumption rates
+        _tracksConsumption = [_writer tableExists:@"consumption_rates"];
+        // From schema v1.13 stock holds lookup table ids, and the names are read through a view
+        FMResultSet *resultSet = [_writer executeQuery:@"SELECT 1 FROM sqlite_master WHERE type = 'view' AND name = 'stock_named'"];
+        _componentSource = [resultSet next] ? @"stock_named" : @"stock";
+        [resultSet close];
+        _readerPool = [FMDatabasePool databasePoolWithPath:path flags:SQLITE_OPEN_READONLY];
+        [_readerPool setMaximumNumberOfDatabasesToCreate:readerCount];
+        [_readerPool setDelegate:self];
+        // Bound concurrent readers to the pool size so excess requests queue instead of failing
+        _readerSlots = dispatch_semaphore_create(readerCount);
+    }
+    return self;
+}
+
+
+- (void)close {
+    dispatch_sync(_writerQueue, ^{
+        [self->_writer close];
+    });
+    [_readerPool releaseAllDatabases];
+}
+
+
+- (void)inReader:(void (^)(FMDatabase *db))block {
+    dispatch_semaphore_wait(_readerSlots, DISPATCH_TIME_FOREVER);
+    [_readerPool inDatabase:^(FMDatabase *db) {
+        block(db);
+    }];
+    dispatch_semaphore_signal(_readerSlots);
+}
+
+
+- (NSArray<NSDictionary *> *)componentsWithPartNumberPrefix:(NSString *)prefix {
+    NSMutableArray<NSDictionary *> *components = [[NSMutableArray alloc] init];
+    [self inReader:^(FMDatabase *db) {
+        NSString *query = [NSString stringWithFormat:@"SELECT * FROM %@ WHERE part_number LIKE ?", self->_componentSource];
+        FMResultSet *resultSet = [db executeQuery:query, [prefix stringByAppendingString:@"%"]];
+        while ([resultSet next]) {
+            [components addObject:[resultSet resultDictionary]];
+        }
+        [resultSet close];
+    }];
+    return components;
+}
+
+
+- (NSArray<NSDictionary *> *)componentsOfType:(NSString *)type {
+    NSMutableArray<NSDictionary *> *components = [[NSMutableArray alloc] init];
+    [self inReader:^(FMDatabase *db) {
+        NSString *query = [NSString stringWithFormat:@"SELECT * FROM %@ WHERE component_type = ?", self->_componentSource];
+        FMResultSet *resultSet = [db executeQuery:query, type];
+        while ([resultSet next]) {
+            [components addObject:[resultSet resultDictionary]];
+        }
+        [resultSet close];
+    }];
+    return components;
+}
+
+
+- (nullable NSDictionary *)componentWithID:(NSNumber *)componentID {
+    __block NSDictionary *component = nil;
+    [self inReader:^(FMDatabase *db) {
+        NSString *query = [NSString stringWithFormat:@"SELECT * FROM %@ WHERE component_id = ?", self->_componentSource];
+        FMResultSet *resultSet = [db executeQuery:query, componentID];
+        if ([resultSet next]) {
+            component = [resultSet resultDictionary];
+        }
+        [resultSet close];
+    }];
+    return component;
+}
+
+
+- (NSDictionary *)historyForComponentID:(NSNumber *)componentID {
+    NSMutableArray<NSDictionary *> *acquisitions = [[NSMutableArray alloc] init];
+    NSMutableArray<NSDictionary *> *expenditures = [[NSMutableArray alloc] init];
+    [self inReader:^(FMDatabase *db) {
+        // Both lists come from the same read transaction so they are mutually consistent
+        [db beginDeferredTransaction];
+        FMResultSet *resultSet = [db executeQuery:@"SELECT id, quantity, date_acquired, origin FROM acquisitions WHERE fk_component_id = ? ORDER BY date_acquired DESC", componentID];
+        while ([resultSet next]) {
+            [acquisitions addObject:[resultSet resultDictionary]];
+        }
+        [resultSet close];
+        resultSet = [db executeQuery:@"SELECT id, quantity, date_spent, destination FROM expenditures WHERE fk_component_id = ? ORDER BY date_spent DESC", componentID];
+        while ([resultSet next]) {
+            [expenditures addObject:[resultSet resultDictionary]];
+        }
+        [resultSet close];
+        [db commit];
+    }];
+    return @{
+        @"acquisitions" : acquisitions,
+        @"expenditures" : expenditures
+    };
+}
+
+#pragma mark - Group Commit
+
+/*
+ Movements are queued and applied by a single writer. Whatever accumulates while a commit is
+ in progress goes into the next transaction, so one fsync covers many requests under load
+ while an isolated request still commits immediately.
+ */
+- (void)recordMovementWithParameters:(NSDictionary *)parameters
+                          completion:(InventoryMovementCompletion)completion {
+    PendingMovement *movement = [[PendingMovement alloc] init];
+    [movement setParameters:parameters];
+    [movement setCompletion:completion];
+    BOOL shouldDrain = NO;
+    [_pendingLock lock];
+    [_pendingMovements addObject:movement];
+    if (!_drainScheduled) {
+        _drainScheduled = YES;
+        shouldDrain = YES;
+    }
+    [_pendingLock unlock];
+    if (shouldDrain) {
+        dispatch_async(_writerQueue, ^{
+            [self drainPendingMovements];
+        });
+    }
+}
+
+
+- (void)drainPendingMovements {
+    while (YES) {
+        NSArray<PendingMovement *> *batch = nil;
+        [_pendingLock lock];
+        NSUInteger pendingCount = [_pendingMovements count];
+        if (pendingCount == 0) {
+            _drainScheduled = NO;
+            [_pendingLock unlock];
+            return;
+        }
+        NSRange batchRange = NSMakeRange(0, MIN(pendingCount, MAX_MOVEMENTS_PER_COMMIT));
+        batch = [_pendingMovements subarrayWithRange:batchRange];
+        [_pendingMovements removeObjectsInRange:batchRange];
+        [_pendingLock unlock];
+        [self commitMovements:batch];
+    }
+}
+
+
+- (void)commitMovements:(NSArray<PendingMovement *> *)batch {
+    if (![_writer beginImmediateTransaction]) {
+        NSString *errorDescription = [_writer lastErrorMessage];
+        for (PendingMovement *movement in batch) {
+            [movement setErrorDescription:errorDescription];
+        }
+    } else {
+        for (PendingMovement *movement in batch) {
+            // A failed movement is undone on its own without discarding the rest of the batch
+            [_writer startSavePointWithName:@"movement" error:nil];
+            if ([self applyMovement:movement]) {
+                [_writer releaseSavePointWithName:@"movement" error:nil];
+            } else {
+                [_writer rollbackToSavePointWithName:@"movement" error:nil];
+                [_writer releaseSavePointWithName:@"movement" error:nil];
+                [movement setUpdatedQuantity:nil];
+            }
+        }
+        if (![_writer commit]) {
+            NSString *errorDescription = [_writer lastErrorMessage];
+            [_writer rollback];
+            for (PendingMovement *movement in batch) {
+                [movement setUpdatedQuantity:nil];
+                [movement setErrorDescription:errorDescription];
+            }
+        }
+    }
+    for (PendingMovement *movement in batch) {
+        NSNumber *updatedQuantity = [movement updatedQuantity];
+        NSString *errorDescription = [movement errorDescription];
+        InventoryMovementCompletion completion = [movement completion];
+        dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+            completion(updatedQuantity, errorDescription);
+        });
+    }
+}
+
+
+- (BOOL)applyMovement:(PendingMovement *)movement {
+    NSDictionary *parameters = [movement parameters];
+    NSNumber *componentID = [parameters objectForKey:@"component_id"];
+    NSNumber *quantity = [parameters objectForKey:@"quantity"];
+    NSString *kind = [parameters objectForKey:@"kind"];
+    BOOL success = NO;
+    if ([kind isEqualToString:@"acquisition"]) {
+        success = [_writer executeUpdate:@"UPDATE stock SET quantity = quantity + ? WHERE component_id = ?", quantity, componentID];
+        if (success && [_writer changes] == 1) {
+            NSDate *dateAcquired = [parameters objectForKey:@"date"];
+            NSString *origin = [parameters objectForKey:@"party"];
+            success = [_writer executeUpdate:@"INSERT INTO acquisitions(fk_component_id, quantity, date_acquired, origin) VALUES(?, ?, ?, ?)", componentID, quantity, FMDB_SQL_NULLABLE(dateAcquired), FMDB_SQL_NULLABLE(origin)];
+        }
+    } else if ([kind isEqualToString:@"expenditure"]) {
+        success = [_writer executeUpdate:@"UPDATE stock SET quantity = quantity - ? WHERE component_id = ?", quantity, componentID];
+        if (success && [_writer changes] == 1) {
+            NSDate *dateSpent = [parameters objectForKey:@"date"];
+            NSString *destination = [parameters objectForKey:@"party"];
+            success = [_writer executeUpdate:@"INSERT INTO expenditures(fk_component_id, quantity, date_spent, destination) VALUES(?, ?, ?, ?)", componentID, quantity, FMDB_SQL_NULLABLE(dateSpent), FMDB_SQL_NULLABLE(destination)];
+            if (success && _tracksConsumption) {
+                success = [ConsumptionForecaster recordExpenditureOfQuantity:[quantity integerValue] componentID:componentID date:dateSpent inDatabase:_writer];
+            }
+        }
+    } else {
+        [movement setErrorDescription:[NSString stringWithFormat:@"Unknown movement kind '%@'.", kind]];
+        return NO;
+    }
+    if (!success) {
+        [movement setErrorDescription:[_writer lastErrorMessage]];
+        return NO;
+    }
+    if ([_writer changes] != 1) {
+        [movement setErrorDescription:[NSString stringWithFormat:@"No component with ID %@.", componentID]];
+        return NO;
+    }
+    FMResultSet *resultSet = [_writer executeQuery:@"SELECT quantity FROM stock WHERE component_id = ?", componentID];
+    if ([resultSet next]) {
+        [movement setUpdatedQuantity:[NSNumber numberWithInteger:[resultSet longForColumn:@"quantity"]]];
+    }
+    [resultSet close];
+    return YES;
+}
+
+#pragma mark - FMDatabasePoolDelegate
+
+- (void)databasePool:(FMDatabasePool *)pool didAddDatabase:(FMDatabase *)database {
+    [database setDateFormat:_dateFormatter];
+    [database setMaxBusyRetryTimeInterval:1.0];
+    [database executeStatements:@"PRAGMA case_sensitive_like=ON"];
+}
+
+@end
@@ -0,0 +1,32 @@
+//
+//  LoadTestClient.h
+//  Stock Service
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*
+ Drives a running service over keep-alive connections and reports throughput and latency
+ percentiles. Write requests are issued as acquisition/expenditure pairs of one unit so the
+ component's stock is left unchanged.
+ */
+@interface LoadTestClient : NSObject
+
+@property uint16_t port;
+@property (nullable) NSString *socketPath;
+@property NSUInteger connectionCount;
+@property NSUInteger requestCount;
+@property double writeRatio;
+@property NSString *partNumberPrefix;
+@property NSNumber *componentID;
+
+- (BOOL)run;
+
+@end
+
+NS_ASSUME_NONNULL_END
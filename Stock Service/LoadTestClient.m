@@ -0,0 +1,200 @@
+//
+//  LoadTestClient.m
+//  Stock Service
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import "LoadTestClient.h"
+#import <sys/socket.h>
+#import <sys/un.h>
+#import <netinet/in.h>
+#import <netinet/tcp.h>
+#import <arpa/inet.h>
+#import <unistd.h>
+#import <time.h>
+
+#define RESPONSE_BUFFER_SIZE 65536
+
+@implementation LoadTestClient
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _port = 8080;
+        _connectionCount = 16;
+        _requestCount = 100000;
+        _writeRatio = 0.1;
+        _partNumberPrefix = @"1N";
+        _componentID = @1;
+    }
+    return self;
+}
+
+
+- (int)openConnection {
+    int connectionSocket = -1;
+    if (_socketPath) {
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_len = sizeof(address);
+        address.sun_family = AF_UNIX;
+        strlcpy(address.sun_path, [_socketPath fileSystemRepresentation], sizeof(address.sun_path));
+        connectionSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(connectionSocket, (struct sockaddr *)&address, sizeof(address)) < 0) {
+            close(connectionSocket);
+            return -1;
+        }
+    } else {
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_len = sizeof(address);
+        address.sin_family = AF_INET;
+        address.sin_port = htons(_port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        connectionSocket = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(connectionSocket, (struct sockaddr *)&address, sizeof(address)) < 0) {
+            close(connectionSocket);
+            return -1;
+        }
+        int enabled = 1;
+        setsockopt(connectionSocket, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+    }
+    int enabled = 1;
+    setsockopt(connectionSocket, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+    return connectionSocket;
+}
+
+
+/*
+ Sends one request and blocks until the complete response has arrived.
+ Returns the HTTP status code, or -1 if the connection failed.
+ */
+static int exchangeRequest(int connectionSocket, NSData *request, uint8_t *buffer) {
+    const uint8_t *bytes = [request bytes];
+    size_t remaining = [request length];
+    while (remaining > 0) {
+        ssize_t written = write(connectionSocket, bytes, remaining);
+        if (written <= 0) {
+            return -1;
+        }
+        bytes += written;
+        remaining -= (size_t)written;
+    }
+    size_t received = 0;
+    size_t headerLength = 0;
+    size_t contentLength = 0;
+    while (headerLength == 0 || received < headerLength + contentLength) {
+        if (received == RESPONSE_BUFFER_SIZE) {
+            return -1;
+        }
+        ssize_t bytesRead = read(connectionSocket, buffer + received, RESPONSE_BUFFER_SIZE - received);
+        if (bytesRead <= 0) {
+            return -1;
+        }
+        received += (size_t)bytesRead;
+        buffer[received] = '\0'; //Buffer has one spare byte for the terminator
+        if (headerLength == 0) {
+            for (size_t i = 3; i < received; i++) {
+                if (buffer[i - 3] == '\r' && buffer[i - 2] == '\n' && buffer[i - 1] == '\r' && buffer[i] == '\n') {
+                    headerLength = i + 1;
+                    break;
+                }
+            }
+            if (headerLength > 0) {
+                const char *field = strcasestr((const char *)buffer, "Content-Length:");
+                if (field && (size_t)(field - (const char *)buffer) < headerLength) {
+                    contentLength = strtoul(field + strlen("Content-Length:"), NULL, 10);
+                }
+            }
+        }
+    }
+    // Status line is "HTTP/1.1 NNN ..."
+    return (int)strtol((const char *)buffer + 9, NULL, 10);
+}
+
+
+- (BOOL)run {
+    NSUInteger connectionCount = MAX(_connectionCount, 1);
+    NSUInteger requestsPerConnection = MAX(_requestCount / connectionCount, 1);
+    NSUInteger writeInterval = _writeRatio > 0.0 ? MAX((NSUInteger)round(1.0 / _writeRatio), 1) : 0;
+    NSString *searchTarget = [NSString stringWithFormat:@"/components?part_number=%@",
+                              [_partNumberPrefix stringByAddingPercentEncodingWithAllowedCharacters:[NSCharacterSet URLQueryAllowedCharacterSet]]];
+    NSData *searchRequest = [[NSString stringWithFormat:@"GET %@ HTTP/1.1\r\nHost: localhost\r\n\r\n", searchTarget] dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *acquisitionRequest = [self movementRequestWithKind:@"acquisition"];
+    NSData *expenditureRequest = [self movementRequestWithKind:@"expenditure"];
+    uint64_t *latencies = calloc(connectionCount * requestsPerConnection, sizeof(uint64_t));
+    __block NSUInteger failureCount = 0;
+    NSLock *failureLock = [[NSLock alloc] init];
+    uint64_t startTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    dispatch_apply(connectionCount, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t worker) {
+        uint8_t *buffer = malloc(RESPONSE_BUFFER_SIZE + 1);
+        uint64_t *workerLatencies = latencies + worker * requestsPerConnection;
+        NSUInteger workerFailures = 0;
+        BOOL nextWriteIsAcquisition = YES;
+        int connectionSocket = [self openConnection];
+        for (NSUInteger i = 0; i < requestsPerConnection; i++) {
+            NSData *request = searchRequest;
+            if (writeInterval > 0 && (i + worker) % writeInterval == 0) {
+                request = nextWriteIsAcquisition ? acquisitionRequest : expenditureRequest;
+                nextWriteIsAcquisition = !nextWriteIsAcquisition;
+            }
+            uint64_t requestStart = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+            int status = connectionSocket < 0 ? -1 : exchangeRequest(connectionSocket, request, buffer);
+            workerLatencies[i] = clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - requestStart;
+            if (status != 200) {
+                workerFailures++;
+                if (status < 0) {
+                    // Reconnect and carry on so one dropped connection doesn't end the run
+                    if (connectionSocket >= 0) {
+                        close(connectionSocket);
+                    }
+                    connectionSocket = [self openConnection];
+                }
+            }
+        }
+        if (connectionSocket >= 0) {
+            close(connectionSocket);
+        }
+        free(buffer);
+        [failureLock lock];
+        failureCount += workerFailures;
+        [failureLock unlock];
+    });
+    uint64_t elapsedTime = clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - startTime;
+    NSUInteger totalCount = connectionCount * requestsPerConnection;
+    qsort_b(latencies, totalCount, sizeof(uint64_t), ^int(const void *a, const void *b) {
+        uint64_t left = *(const uint64_t *)a;
+        uint64_t right = *(const uint64_t *)b;
+        return left < right ? -1 : (left > right ? 1 : 0);
+    });
+    double seconds = elapsedTime / 1e9;
+    printf("%lu requests over %lu connections in %.3f s (%.0f requests/s), %lu failed\n",
+           (unsigned long)totalCount, (unsigned long)connectionCount, seconds, totalCount / seconds, (unsigned long)failureCount);
+    double percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+        NSUInteger rank = MIN((NSUInteger)ceil(percentiles[i] / 100.0 * totalCount), totalCount) - 1;
+        printf("p%-5g %9.3f ms\n", percentiles[i], latencies[rank] / 1e6);
+    }
+    printf("max    %9.3f ms\n", latencies[totalCount - 1] / 1e6);
+    free(latencies);
+    return failureCount == 0;
+}
+
+
+- (NSData *)movementRequestWithKind:(NSString *)kind {
+    NSDictionary *movement = @{
+        @"kind"     : kind,
+        @"quantity" : @1,
+        @"party"    : @"Load test"
+    };
+    NSData *body = [NSJSONSerialization dataWithJSONObject:movement options:0 error:nil];
+    NSString *header = [NSString stringWithFormat:@"POST /components/%@/movements HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/json\r\nContent-Length: %lu\r\n\r\n",
+                        _componentID, (unsigned long)[body length]];
+    NSMutableData *request = [[header dataUsingEncoding:NSUTF8StringEncoding] mutableCopy];
+    [request appendData:body];
+    return request;
+}
+
+@end
@@ -0,0 +1,120 @@
+//
+//  main.m
+//  Stock Service
+//
+//  Created by Douglas Almeida on 19/10/26.
+//  Copyright © 2026 Douglas Almeida. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <signal.h>
+#import "InventoryStore.h"
+#import "InventoryServer.h"
+#import "LoadTestClient.h"
+
+static void printUsage(void) {
+    fprintf(stderr,
+            "usage: stockd serve --database <path> [--port <port> | --socket <path>] [--readers <count>]\n"
+            "       stockd loadtest [--port <port> | --socket <path>] [--connections <count>] [--requests <count>]\n"
+            "                       [--write-ratio <fraction>] [--part-number <prefix>] [--component-id <id>]\n");
+}
+
+
+static NSDictionary<NSString *, NSString *> *optionsFromArguments(NSArray<NSString *> *arguments) {
+    NSMutableDictionary<NSString *, NSString *> *options = [[NSMutableDictionary alloc] init];
+    for (NSUInteger i = 2; i + 1 < [arguments count]; i += 2) {
+        if (![arguments[i] hasPrefix:@"--"]) {
+            return nil;
+        }
+        [options setObject:arguments[i + 1] forKey:[arguments[i] substringFromIndex:2]];
+    }
+    return options;
+}
+
+
+static int serve(NSDictionary<NSString *, NSString *> *options) {
+    NSString *databasePath = [options objectForKey:@"database"];
+    if (!databasePath) {
+        printUsage();
+        return 64;
+    }
+    NSUInteger readerCount = [options objectForKey:@"readers"] ? (NSUInteger)[[options objectForKey:@"readers"] integerValue] : [[NSProcessInfo processInfo] activeProcessorCount];
+    InventoryStore *store = [[InventoryStore alloc] initWithPath:databasePath readerCount:MAX(readerCount, 1)];
+    if (!store) {
+        return 1;
+    }
+    InventoryServer *server = [[InventoryServer alloc] initWithStore:store];
+    NSString *socketPath = [options objectForKey:@"socket"];
+    BOOL listening = NO;
+    if (socketPath) {
+        listening = [server listenOnSocketPath:socketPath];
+    } else {
+        uint16_t port = [options objectForKey:@"port"] ? (uint16_t)[[options objectForKey:@"port"] integerValue] : 8080;
+        listening = [server listenOnPort:port];
+    }
+    if (!listening) {
+        [store close];
+        return 1;
+    }
+    // Shut down cleanly on SIGINT/SIGTERM so the WAL is checkpointed
+    dispatch_source_t signalSources[2];
+    int signals[2] = { SIGINT, SIGTERM };
+    for (int i = 0; i < 2; i++) {
+        signal(signals[i], SIG_IGN);
+        signalSources[i] = dispatch_source_create(DISPATCH_SOURCE_TYPE_SIGNAL, (uintptr_t)signals[i], 0, dispatch_get_main_queue());
+        dispatch_source_set_event_handler(signalSources[i], ^{
+            [server stop];
+            [store close];
+            exit(0);
+        });
+        dispatch_resume(signalSources[i]);
+    }
+    dispatch_main();
+}
+
+
+static int loadTest(NSDictionary<NSString *, NSString *> *options) {
+    LoadTestClient *client = [[LoadTestClient alloc] init];
+    if ([options objectForKey:@"socket"]) {
+        [client setSocketPath:[options objectForKey:@"socket"]];
+    }
+    if ([options objectForKey:@"port"]) {
+        [client setPort:(uint16_t)[[options objectForKey:@"port"] integerValue]];
+    }
+    if ([options objectForKey:@"connections"]) {
+        [client setConnectionCount:(NSUInteger)[[options objectForKey:@"connections"] integerValue]];
+    }
+    if ([options objectForKey:@"requests"]) {
+        [client setRequestCount:(NSUInteger)[[options objectForKey:@"requests"] integerValue]];
+    }
+    if ([options objectForKey:@"write-ratio"]) {
+        [client setWriteRatio:[[options objectForKey:@"write-ratio"] doubleValue]];
+    }
+    if ([options objectForKey:@"part-number"]) {
+        [client setPartNumberPrefix:[options objectForKey:@"part-number"]];
+    }
+    if ([options objectForKey:@"component-id"]) {
+        [client setComponentID:[NSNumber numberWithInteger:[[options objectForKey:@"component-id"] integerValue]]];
+    }
+    return [client run] ? 0 : 1;
+}
+
+
+int main(int argc, const char * argv[]) {
+    @autoreleasepool {
+        NSArray<NSString *> *arguments = [[NSProcessInfo processInfo] arguments];
+        NSDictionary<NSString *, NSString *> *options = optionsFromArguments(arguments);
+        if ([arguments count] < 2 || !options) {
+            printUsage();
+            return 64;
+        }
+        if ([arguments[1] isEqualToString:@"serve"]) {
+            return serve(options);
+        }
+        if ([arguments[1] isEqualToString:@"loadtest"]) {
+            return loadTest(options);
+        }
+        printUsage();
+        return 64;
+    }
+}
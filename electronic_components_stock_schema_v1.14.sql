@@ -0,0 +1,172 @@
+/*
+Scheme for creating the electronic components database for stock management.
+Version: 1.14.
+*/
+
+-- Lets the application return free pages to the file system a few at a time while idle
+PRAGMA auto_vacuum = INCREMENTAL;
+
+CREATE TABLE "stock" (
+    "component_id"          INTEGER PRIMARY KEY AUTOINCREMENT, -- ROWID
+    "part_number"           TEXT NOT NULL,
+    "manufacturer_id"       INTEGER REFERENCES "manufacturers"("id"),
+    "quantity"              INTEGER NOT NULL DEFAULT 0 CHECK("quantity" >= 0),
+    "component_type_id"     INTEGER NOT NULL REFERENCES "component_types"("id"),
+    "voltage_rating"        REAL,   -- Volts
+    "current_rating"        REAL,   -- Amperes
+    "power_rating"          REAL,   -- Watts
+    "resistance_rating"     REAL,   -- Ohms
+    "inductance_rating"     REAL,   -- Henries
+    "capacitance_rating"    REAL,   -- Farads
+    "frequency_rating"      REAL,   -- Hertz
+    "tolerance_rating"      REAL,   -- Percent
+    "package_code_id"       INTEGER REFERENCES "package_codes"("id"), -- Codes in inches
+    "comments"              TEXT,
+    "part_key"              TEXT,   -- Normalized part number (maintained by triggers)
+    "manufacturer_key"      TEXT NOT NULL DEFAULT '', -- Normalized manufacturer (maintained by triggers)
+    "min_quantity"          INTEGER CHECK("min_quantity" >= 0), -- Reorder threshold
+    "part_sort_key"         TEXT,   -- Natural order key of the part number (written by the application)
+    UNIQUE("part_number", "manufacturer_id")
+);
+
+CREATE TABLE "acquisitions" (
+    "id"                INTEGER PRIMARY KEY AUTOINCREMENT, -- ROWID
+    "fk_component_id"   INTEGER NOT NULL,
+    "quantity"          INTEGER NOT NULL CHECK("quantity" > 0),
+    "date_acquired"     TEXT, -- ISO 8601 (yyyy-mm-ddT00:00:00±hh:mm)
+    "origin"            TEXT,
+	FOREIGN KEY("fk_component_id") REFERENCES "stock"("component_id") ON UPDATE CASCADE ON DELETE CASCADE
+);
+
+CREATE TABLE "expenditures" (
+    "id"                INTEGER PRIMARY KEY AUTOINCREMENT, -- ROWID
+    "fk_component_id"   INTEGER NOT NULL,
+    "quantity"          INTEGER NOT NULL CHECK("quantity" > 0),
+    "date_spent"        TEXT, -- ISO 8601 (yyyy-mm-ddT00:00:00±hh:mm)
+    "destination"       TEXT,
+	FOREIGN KEY("fk_component_id") REFERENCES "stock"("component_id") ON UPDATE CASCADE ON DELETE CASCADE
+);
+
+-- NULL-safe key: UNIQUE("part_number", "manufacturer_id") above lets NULL manufacturers repeat
+CREATE UNIQUE INDEX "stock_part_key" ON "stock"("part_number", IFNULL("manufacturer_id", 0));
+
+-- Normalized keys for duplicate and near-duplicate detection
+CREATE INDEX "stock_normalized_key" ON "stock"("part_key", "manufacturer_key");
+
+CREATE TRIGGER "stock_normalized_key_insert" AFTER INSERT ON "stock" BEGIN
+    UPDATE "stock" SET "part_key" = upper(replace(replace(replace(replace(replace(replace(NEW."part_number", ' ', ''), '-', ''), '.', ''), '/', ''), '_', ''), ',', '')), "manufacturer_key" = upper(replace(replace(replace(replace(replace(replace(IFNULL((SELECT "name" FROM "manufacturers" WHERE "id" = NEW."manufacturer_id"), ''), ' ', ''), '-', ''), '.', ''), '/', ''), '_', ''), ',', '')) WHERE "component_id" = NEW."component_id";
+END;
+
+CREATE TRIGGER "stock_normalized_key_update" AFTER UPDATE OF "part_number", "manufacturer_id" ON "stock" BEGIN
+    UPDATE "stock" SET "part_key" = upper(replace(replace(replace(replace(replace(replace(NEW."part_number", ' ', ''), '-', ''), '.', ''), '/', ''), '_', ''), ',', '')), "manufacturer_key" = upper(replace(replace(replace(replace(replace(replace(IFNULL((SELECT "name" FROM "manufacturers" WHERE "id" = NEW."manufacturer_id"), ''), ' ', ''), '-', ''), '.', ''), '/', ''), '_', ''), ',', '')) WHERE "component_id" = NEW."component_id";
+END;
+
+-- Part numbers in natural order ("R2" before "R10"), ranges of prefixes included. Keys are computed by the
+-- application, which also registers natural_sort_key() on its connection to fill them on migration
+CREATE INDEX "stock_part_natural" ON "stock"("part_sort_key");
+
+-- Components below their reorder threshold; the list of alerts is read from this index alone
+CREATE INDEX "stock_below_minimum" ON "stock"("part_number") WHERE "quantity" < "min_quantity";
+
+-- Parametric search: a type equality and a value range, with the package checked from the index
+CREATE INDEX "stock_type_resistance" ON "stock"("component_type_id", "resistance_rating", "package_code_id");
+CREATE INDEX "stock_type_capacitance" ON "stock"("component_type_id", "capacitance_rating", "package_code_id");
+CREATE INDEX "stock_type_inductance" ON "stock"("component_type_id", "inductance_rating", "package_code_id");
+CREATE INDEX "stock_type_voltage" ON "stock"("component_type_id", "voltage_rating", "package_code_id");
+
+-- Nearest stocked value: in-stock parts ordered by value, with package and tolerance checked from the index
+CREATE INDEX "stock_stocked_resistance" ON "stock"("resistance_rating", "package_code_id", "tolerance_rating") WHERE "quantity" > 0;
+CREATE INDEX "stock_stocked_capacitance" ON "stock"("capacitance_rating", "package_code_id", "tolerance_rating") WHERE "quantity" > 0;
+CREATE INDEX "stock_stocked_inductance" ON "stock"("inductance_rating", "package_code_id", "tolerance_rating") WHERE "quantity" > 0;
+
+-- Distinct values stored in "stock" by id. Rows outlive their last use, so an id always names the same value;
+-- "ref_count" tells which are in use and "component_types" also sums up stock per type, both kept by triggers
+CREATE TABLE "component_types" (
+    "id"                INTEGER PRIMARY KEY, -- ROWID
+    "name"              TEXT NOT NULL UNIQUE,
+    "ref_count"         INTEGER NOT NULL DEFAULT 0, -- Components of this type
+    "total_quantity"    INTEGER NOT NULL DEFAULT 0  -- Units in stock of this type
+);
+
+CREATE TABLE "manufacturers" (
+    "id"        INTEGER PRIMARY KEY, -- ROWID
+    "name"      TEXT NOT NULL UNIQUE,
+    "ref_count" INTEGER NOT NULL DEFAULT 0
+);
+
+CREATE TABLE "package_codes" (
+    "id"        INTEGER PRIMARY KEY, -- ROWID
+    "name"      TEXT NOT NULL UNIQUE,
+    "ref_count" INTEGER NOT NULL DEFAULT 0
+);
+
+CREATE TRIGGER "stock_lookup_insert" AFTER INSERT ON "stock" BEGIN
+    UPDATE "component_types" SET "ref_count" = "ref_count" + 1, "total_quantity" = "total_quantity" + NEW."quantity" WHERE "id" = NEW."component_type_id";
+    UPDATE "manufacturers" SET "ref_count" = "ref_count" + 1 WHERE "id" = NEW."manufacturer_id";
+    UPDATE "package_codes" SET "ref_count" = "ref_count" + 1 WHERE "id" = NEW."package_code_id";
+END;
+
+CREATE TRIGGER "stock_lookup_delete" AFTER DELETE ON "stock" BEGIN
+    UPDATE "component_types" SET "ref_count" = "ref_count" - 1, "total_quantity" = "total_quantity" - OLD."quantity" WHERE "id" = OLD."component_type_id";
+    UPDATE "manufacturers" SET "ref_count" = "ref_count" - 1 WHERE "id" = OLD."manufacturer_id";
+    UPDATE "package_codes" SET "ref_count" = "ref_count" - 1 WHERE "id" = OLD."package_code_id";
+END;
+
+CREATE TRIGGER "stock_lookup_update_type" AFTER UPDATE OF "component_type_id" ON "stock" WHEN OLD."component_type_id" IS NOT NEW."component_type_id" BEGIN
+    UPDATE "component_types" SET "ref_count" = "ref_count" - 1, "total_quantity" = "total_quantity" - OLD."quantity" WHERE "id" = OLD."component_type_id";
+    UPDATE "component_types" SET "ref_count" = "ref_count" + 1, "total_quantity" = "total_quantity" + NEW."quantity" WHERE "id" = NEW."component_type_id";
+END;
+
+CREATE TRIGGER "stock_lookup_update_manufacturer" AFTER UPDATE OF "manufacturer_id" ON "stock" WHEN OLD."manufacturer_id" IS NOT NEW."manufacturer_id" BEGIN
+    UPDATE "manufacturers" SET "ref_count" = "ref_count" - 1 WHERE "id" = OLD."manufacturer_id";
+    UPDATE "manufacturers" SET "ref_count" = "ref_count" + 1 WHERE "id" = NEW."manufacturer_id";
+END;
+
+CREATE TRIGGER "stock_lookup_update_package" AFTER UPDATE OF "package_code_id" ON "stock" WHEN OLD."package_code_id" IS NOT NEW."package_code_id" BEGIN
+    UPDATE "package_codes" SET "ref_count" = "ref_count" - 1 WHERE "id" = OLD."package_code_id";
+    UPDATE "package_codes" SET "ref_count" = "ref_count" + 1 WHERE "id" = NEW."package_code_id";
+END;
+
+CREATE TRIGGER "stock_lookup_update_quantity" AFTER UPDATE OF "quantity" ON "stock" WHEN OLD."quantity" IS NOT NEW."quantity" AND OLD."component_type_id" IS NEW."component_type_id" BEGIN
+    UPDATE "component_types" SET "total_quantity" = "total_quantity" + NEW."quantity" - OLD."quantity" WHERE "id" = NEW."component_type_id";
+END;
+
+-- Stock with the names of its type, manufacturer and package code, in the column layout of schema v1.12 and earlier
+CREATE VIEW "stock_named" AS
+    SELECT "stock"."component_id", "stock"."part_number", "manufacturers"."name" AS "manufacturer", "stock"."quantity",
+           "component_types"."name" AS "component_type", "stock"."voltage_rating", "stock"."current_rating", "stock"."power_rating",
+           "stock"."resistance_rating", "stock"."inductance_rating", "stock"."capacitance_rating", "stock"."frequency_rating",
+           "stock"."tolerance_rating", "package_codes"."name" AS "package_code", "stock"."comments", "stock"."part_key",
+           "stock"."manufacturer_key", "stock"."min_quantity"
+    FROM "stock"
+    JOIN "component_types" ON "component_types"."id" = "stock"."component_type_id"
+    LEFT JOIN "manufacturers" ON "manufacturers"."id" = "stock"."manufacturer_id"
+    LEFT JOIN "package_codes" ON "package_codes"."id" = "stock"."package_code_id";
+
+-- Exponentially decayed expenditure sums over 30, 90 and 365 days, maintained by the application
+CREATE TABLE "consumption_rates" (
+    "fk_component_id"   INTEGER PRIMARY KEY,
+    "usage_30"          REAL NOT NULL DEFAULT 0,
+    "usage_90"          REAL NOT NULL DEFAULT 0,
+    "usage_365"         REAL NOT NULL DEFAULT 0,
+    "reference_time"    REAL NOT NULL, -- Seconds since 1970 the sums are decayed to
+	FOREIGN KEY("fk_component_id") REFERENCES "stock"("component_id") ON UPDATE CASCADE ON DELETE CASCADE
+);
+
+-- Bills of materials
+CREATE TABLE "boms" (
+    "id"        INTEGER PRIMARY KEY AUTOINCREMENT, -- ROWID
+    "name"      TEXT NOT NULL UNIQUE,
+    "comments"  TEXT
+);
+
+CREATE TABLE "bom_lines" (
+    "fk_bom_id"         INTEGER NOT NULL,
+    "fk_component_id"   INTEGER NOT NULL,
+    "quantity"          INTEGER NOT NULL CHECK("quantity" > 0), -- Units needed per build
+    PRIMARY KEY("fk_bom_id", "fk_component_id"),
+	FOREIGN KEY("fk_bom_id") REFERENCES "boms"("id") ON UPDATE CASCADE ON DELETE CASCADE,
+	FOREIGN KEY("fk_component_id") REFERENCES "stock"("component_id") ON UPDATE CASCADE ON DELETE CASCADE
+) WITHOUT ROWID;
+
+PRAGMA user_version = 14;